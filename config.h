@@ -53,12 +53,18 @@
 #define UTIL_WEIGHT .60
 
 /* 
- * Alignment requirement in bytes (either 4 or 8) 
+ * Alignment requirement in bytes: 8 for the 32-bit block layout
+ * (4-byte header words), 16 for the 64-bit one built with MM_LAYOUT64
+ * (8-byte header words, as SSE/AVX types and x86-64 malloc need)
  */
+#ifdef MM_LAYOUT64
+#define ALIGNMENT 16
+#else
 #define ALIGNMENT 8  
+#endif
 
 /* 
- * Maximum heap size in bytes 
+ * Default maximum heap size in bytes (see mem_set_heap_limit) 
  */
 #define MAX_HEAP (20*(1<<20))  /* 20 MB */
 
@@ -0,0 +1,189 @@
+/*
+ * libmm.c - the C library's allocation interface on top of mm.c, built
+ *     as libmm.so so that an unmodified program can be run on mm.c:
+ *
+ *         LD_PRELOAD=./libmm.so sort big.txt
+ *
+ * The heap lives in memlib's mmap-backed regions, so it never touches
+ * the libc heap. mm.c and memlib are set up on the first call, whichever
+ * entry point that is, and fork is made safe with pthread_atfork.
+ *
+ * All the aligned allocation calls are replaced too, so that no pointer
+ * from the libc malloc can ever reach mm_free.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "mm.h"
+#include "memlib.h"
+#include "config.h"
+
+#define EXPORT __attribute__((visibility("default")))
+
+/* Heap limit when MM_HEAP_LIMIT is not set. Only the pages in use are
+   ever committed, and blocks past the mmap threshold are mapped apart. */
+#define DEFAULT_HEAP_LIMIT (sizeof(void *) > 4 ? (64UL << 30) : (512UL << 20))
+
+/* malloc must return memory aligned for any type */
+typedef char alignment_check[ALIGNMENT >= 2 * sizeof(void *) ? 1 : -1];
+
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+static void libmm_init_once(void)
+{
+    if (getenv("MM_HEAP_LIMIT") == NULL)
+	mem_set_heap_limit(DEFAULT_HEAP_LIMIT);
+    mem_init();
+    mm_init();
+}
+
+static inline void libmm_init(void)
+{
+    pthread_once(&init_once, libmm_init_once);
+}
+
+/*
+ * libmm_constructor - initialize at load time, and only then register the
+ *     fork handlers: pthread_atfork may itself allocate.
+ */
+static void __attribute__((constructor)) libmm_constructor(void)
+{
+    libmm_init();
+    pthread_atfork(mm_prefork, mm_postfork, mm_postfork);
+}
+
+/* is_power_of_2 - is x a nonzero power of 2? */
+static inline int is_power_of_2(size_t x)
+{
+    return x != 0 && (x & (x - 1)) == 0;
+}
+
+/*
+ * too_large - no object may be larger than PTRDIFF_MAX, or pointer
+ *     differences within it would overflow. Such requests fail with ENOMEM
+ *     before they reach mm.c.
+ */
+static inline int too_large(size_t size)
+{
+    if (size > PTRDIFF_MAX) {
+	errno = ENOMEM;
+	return 1;
+    }
+    return 0;
+}
+
+static void *aligned(size_t alignment, size_t size)
+{
+    void *p;
+
+    if (too_large(size))
+	return NULL;
+    libmm_init();
+    if ((p = mm_memalign(alignment, size ? size : 1)) == NULL)
+	errno = ENOMEM;
+    return p;
+}
+
+EXPORT void *malloc(size_t size)
+{
+    void *p;
+
+    if (too_large(size))
+	return NULL;
+    libmm_init();
+    if ((p = mm_malloc(size ? size : 1)) == NULL)
+	errno = ENOMEM;
+    return p;
+}
+
+EXPORT void free(void *ptr)
+{
+    if (ptr != NULL)
+	mm_free(ptr);
+}
+
+EXPORT void *realloc(void *ptr, size_t size)
+{
+    void *p;
+
+    if (ptr == NULL)
+	return malloc(size);
+    if (size == 0) {
+	mm_free(ptr);
+	return NULL;
+    }
+    if (too_large(size))
+	return NULL;
+    if ((p = mm_realloc(ptr, size)) == NULL)
+	errno = ENOMEM;
+    return p;
+}
+
+EXPORT void *calloc(size_t nmemb, size_t size)
+{
+    void *p;
+
+    if (nmemb == 0 || size == 0)
+	nmemb = size = 1;
+    if (too_large(nmemb > PTRDIFF_MAX / size ? (size_t)-1 : nmemb * size))
+	return NULL;
+    libmm_init();
+    if ((p = mm_calloc(nmemb, size)) == NULL)
+	errno = ENOMEM;
+    return p;
+}
+
+EXPORT int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    void *p;
+
+    if (!is_power_of_2(alignment) || alignment % sizeof(void *) != 0)
+	return EINVAL;
+    if (size > PTRDIFF_MAX)
+	return ENOMEM;
+    libmm_init();
+    if ((p = mm_memalign(alignment, size ? size : 1)) == NULL)
+	return ENOMEM;
+    *memptr = p;
+    return 0;
+}
+
+EXPORT void *aligned_alloc(size_t alignment, size_t size)
+{
+    if (!is_power_of_2(alignment)) {
+	errno = EINVAL;
+	return NULL;
+    }
+    return aligned(alignment, size);
+}
+
+EXPORT void *memalign(size_t alignment, size_t size)
+{
+    if (!is_power_of_2(alignment)) {
+	errno = EINVAL;
+	return NULL;
+    }
+    return aligned(alignment, size);
+}
+
+EXPORT void *valloc(size_t size)
+{
+    return aligned(mem_pagesize(), size);
+}
+
+EXPORT void *pvalloc(size_t size)
+{
+    size_t page = mem_pagesize();
+
+    if (too_large(size))
+	return NULL;
+    return aligned(page, (size + page - 1) & ~(page - 1));
+}
+
+EXPORT size_t malloc_usable_size(void *ptr)
+{
+    return mm_usable_size(ptr);
+}
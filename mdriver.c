@@ -14,7 +14,10 @@
 #include <string.h>
 #include <assert.h>
 #include <float.h>
+#include <limits.h>
 #include <time.h>
+#include <pthread.h>
+#include <sched.h>
 
 #include "mm.h"
 #include "memlib.h"
@@ -29,9 +32,15 @@
 #define MAXLINE     1024 /* max string size */
 #define HDRLINES       4 /* number of header lines in a trace file */
 #define LINENUM(i) (i+5) /* cnvt trace request nums to linenums (origin 1) */
+#define LAT_REPS       5 /* replays per trace when measuring per-op latency */
+#define SCALE_REPS     4 /* replays of every trace per thread in -T mode */
+#define MAX_THREADS   64 /* most threads the -T mode will start */
+#define PC_RING     1024 /* slots in each producer/consumer ring (-P) */
+#define POOL_OBJS  10000 /* objects live at once in the pool benchmark (-O) */
+#define POOL_REPS     10 /* runs of each pool benchmark, the fastest counts */
 
 /* Returns true if p is ALIGNMENT-byte aligned */
-#define IS_ALIGNED(p)  ((((unsigned int)(p)) % ALIGNMENT) == 0)
+#define IS_ALIGNED(p)  ((((size_t)(p)) % ALIGNMENT) == 0)
 
 /****************************** 
  * The key compound data types 
@@ -46,9 +55,21 @@ typedef struct range_t {
 
 /* Characterizes a single trace operation (allocator request) */
 typedef struct {
-    enum {ALLOC, FREE, REALLOC} type; /* type of request */
+    enum {ALLOC, FREE, REALLOC, MEMALIGN, 
+	  BATCH_ALLOC, BATCH_FREE, CALLOC,
+	  SCOPE_BEGIN, SCOPE_END} type; /* type of request */
     int index;                        /* index for free() to use later */
-    int size;                         /* byte size of alloc/realloc request */
+    int size;                         /* byte size of alloc/realloc request,
+					 or of the block a free releases */
+    int align;                        /* alignment of a memalign request */
+    int count;                        /* number of ids a batch covers */
+    int nmemb;                        /* elements of a calloc request, which
+					 size is the total byte size of */
+    int elsize;                       /* byte size of one of those elements */
+    int scoped;                       /* alloc, realloc or free of a block
+					 allocated in a region scope */
+    int oldsize;                      /* byte size of the block a realloc
+					 request resizes */
 } traceop_t;
 
 /* Holds the information for one trace file*/
@@ -56,7 +77,9 @@ typedef struct {
     int sugg_heapsize;   /* suggested heap size (unused) */
     int num_ids;         /* number of alloc/realloc ids */
     int num_ops;         /* number of distinct requests */
+    int num_reqs;        /* number of blocks requested or freed */
     int weight;          /* weight for this trace (unused) */
+    int num_scopes;      /* number of region scopes */
     traceop_t *ops;      /* array of requests */
     char **blocks;       /* array of ptrs returned by malloc/realloc... */
     size_t *block_sizes; /* ... and a corresponding array of payload sizes */
@@ -72,6 +95,26 @@ typedef struct {
     range_t *ranges;
 } speed_t;
 
+/* Holds the params to one thread of the thread scaling run */
+typedef struct {
+    trace_t **traces;  /* traces to replay */
+    int num_traces;    /* number of traces */
+    char ***blocks;    /* this thread's own block array for each trace */
+} scale_t;
+
+/* 
+ * One producer/consumer pair of the -P mode: the producer mallocs and
+ * hands each block through a single-producer single-consumer ring to
+ * the consumer, which frees it.
+ */
+typedef struct {
+    trace_t **traces;      /* traces whose malloc sizes are replayed */
+    int num_traces;        /* number of traces */
+    char *ring[PC_RING];   /* blocks in flight */
+    unsigned head;         /* next slot to consume */
+    unsigned tail;         /* next slot to produce */
+} pc_t;
+
 /* Summarizes the important stats for some malloc function on some trace */
 typedef struct {
     /* defined for both libc malloc and student malloc package (mm.c) */
@@ -82,6 +125,21 @@ typedef struct {
     /* defined only for the student malloc package */
     double util;     /* space utilization for this trace (always 0 for libc) */
 
+    /* footprint over the trace, measured with util */
+    double fp_peak;    /* largest heap plus mapped bytes */
+    double fp_avg;     /* mean footprint over all requests */
+    double fp_end;     /* footprint after the last request */
+    double util_avg;   /* mean payload over mean footprint */
+    double rss_avg;    /* mean resident bytes of the footprint (-U) */
+    double rss_end;    /* resident bytes after the last request (-U) */
+    size_t pages_end;  /* base pages backing the heap at the end (-U) */
+    size_t huge_end;   /* huge pages backing the heap at the end (-U) */
+    mm_quick_stats_t quick; /* deferred coalescing over the trace (-Q) */
+
+    /* defined only if per-op latency was measured (-L) */
+    double lat_max[3]; /* worst-case ns for one malloc, free, and realloc */
+    double lat_avg;    /* mean ns per op over the whole trace */
+
     /* Note: secs and util are only defined if valid is true */
 } stats_t; 
 
@@ -90,6 +148,11 @@ typedef struct {
  *******************/
 int verbose = 0;        /* global flag for verbose output */
 static int errors = 0;  /* number of errs found when running student malloc */
+static int track_rss = 0; /* sample resident memory in eval_mm_util (-U) */
+static int free_sized = 0; /* replay frees with mm_free_sized (-S) */
+static int unbatch = 0;   /* replay batches one block at a time (-b) */
+static int naive_calloc = 0; /* replay callocs as malloc and memset (-Z) */
+static int region_scopes = 0; /* replay region scopes with mm_region (-R) */
 char msg[MAXLINE];      /* for whenever we need to compose an error message */
 
 /* Directory where default tracefiles are found */
@@ -113,6 +176,7 @@ static void clear_ranges(range_t **ranges);
 
 /* These functions read, allocate, and free storage for traces */
 static trace_t *read_trace(char *tracedir, char *filename);
+static void unbatch_trace(trace_t *trace);
 static void free_trace(trace_t *trace);
 
 /* Routines for evaluating the correctness and speed of libc malloc */
@@ -122,11 +186,22 @@ static void eval_libc_speed(void *ptr);
 /* Routines for evaluating correctnes, space utilization, and speed 
    of the student's malloc package in mm.c */
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges);
-static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
+static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges,
+			   stats_t *stats);
 static void eval_mm_speed(void *ptr);
+static void eval_mm_latency(trace_t *trace, stats_t *stats);
+static void eval_mm_scaling(char **tracefiles, int num_tracefiles, 
+			    int max_threads);
+static void eval_mm_prodcons(char **tracefiles, int num_tracefiles, 
+			     int num_pairs);
+static void eval_mm_pool(void);
+static void eval_mm_policies(char **tracefiles, int num_tracefiles);
 
 /* Various helper routines */
-static void printresults(int n, stats_t *stats);
+static void printresults(int n, char **tracefiles, stats_t *stats);
+static void printlatency(int n, char **tracefiles, stats_t *stats);
+static void printfootprint(int n, char **tracefiles, stats_t *stats);
+static void printquick(int n, char **tracefiles, stats_t *stats);
 static void usage(void);
 static void unix_error(char *msg);
 static void malloc_error(int tracenum, int opnum, char *msg);
@@ -150,6 +225,14 @@ int main(int argc, char **argv)
     int team_check = 1;  /* If set, check team structure (reset by -a) */
     int run_libc = 0;    /* If set, run libc malloc (set by -l) */
     int autograder = 0;  /* If set, emit summary info for autograder (-g) */
+    int run_latency = 0; /* If set, measure per-op latency of mm (-L) */
+    int show_footprint = 0; /* If set, print footprint over time of mm (-U) */
+    int show_quick = 0;  /* If set, print the deferred coalescing of mm (-Q) */
+    int max_threads = -1;/* If >= 0, measure thread scaling up to this (-T) */
+    int num_pairs = 0;   /* If > 0, run this many producer/consumer pairs (-P) */
+    int run_pool = 0;    /* If set, compare mm_pool with mm_malloc (-O) */
+    int run_policies = 0;/* If set, compare the placement policies of mm (-F) */
+    size_t heap_limit;   /* How far the simulated heap may grow (-H) */
 
     /* temporaries used to compute the performance index */
     double secs, ops, util, avg_mm_util, avg_mm_throughput, p1, p2, perfindex;
@@ -158,7 +241,7 @@ int main(int argc, char **argv)
     /* 
      * Read and interpret the command line arguments 
      */
-    while ((c = getopt(argc, argv, "f:t:hvVgal")) != EOF) {
+    while ((c = getopt(argc, argv, "f:t:hvVgabBFlLm:H:OP:QST:RUZ")) != EOF) {
         switch (c) {
 	case 'g': /* Generate summary info for the autograder */
 	    autograder = 1;
@@ -181,9 +264,59 @@ int main(int argc, char **argv)
         case 'a': /* Don't check team structure */
             team_check = 0;
             break;
+        case 'b': /* Replay batch requests one block at a time */
+            unbatch = 1;
+            break;
+        case 'B': /* Back the heap with huge pages, and show what it got */
+            mem_set_huge_pages(1);
+            show_footprint = 1;
+            track_rss = 1;
+            break;
+        case 'F': /* Compare the placement policies of mm malloc */
+            run_policies = 1;
+            break;
         case 'l': /* Run libc malloc */
             run_libc = 1;
             break;
+        case 'L': /* Measure worst-case per-op latency of mm malloc */
+            run_latency = 1;
+            break;
+        case 'm': /* Serve requests of at least this many bytes by mmap */
+            mm_set_mmap_threshold(strtoul(optarg, NULL, 0));
+            break;
+        case 'H': /* Let the simulated heap grow to this many bytes */
+            if ((heap_limit = mem_parse_size(optarg)) == 0) {
+                printf("%s: bad heap limit '%s'\n", argv[0], optarg);
+                usage();
+                exit(1);
+            }
+            mem_set_heap_limit(heap_limit);
+            break;
+        case 'O': /* Compare object pools with mm_malloc */
+            run_pool = 1;
+            break;
+        case 'P': /* Free blocks in other threads than malloced them */
+            num_pairs = atoi(optarg);
+            break;
+        case 'S': /* Tell mm the size of each block it frees */
+            free_sized = 1;
+            break;
+        case 'T': /* Measure throughput scaling from 1 to n threads */
+            max_threads = atoi(optarg);
+            break;
+        case 'U': /* Print how the mm footprint evolves over each trace */
+            show_footprint = 1;
+            track_rss = 1;
+            break;
+        case 'Z': /* Zero calloc blocks with memset, to compare with mm_calloc */
+            naive_calloc = 1;
+            break;
+        case 'Q': /* Print how many coalesce/split pairs the quick lists and tcache saved */
+            show_quick = 1;
+            break;
+        case 'R': /* Free the blocks of region scopes with mm_region_reset */
+            region_scopes = 1;
+            break;
         case 'v': /* Print per-trace performance breakdown */
             verbose = 1;
             break;
@@ -234,6 +367,9 @@ int main(int argc, char **argv)
         num_tracefiles = sizeof(default_tracefiles) / sizeof(char *) - 1;
 	printf("Using default tracefiles in %s\n", tracedir);
     }
+    if (verbose)
+	printf("Checking payloads for %d-byte alignment (%s block layout)\n",
+	       ALIGNMENT, ALIGNMENT == 16 ? "64-bit" : "32-bit");
 
     /* Initialize the timing package */
     init_fsecs();
@@ -253,7 +389,7 @@ int main(int argc, char **argv)
 	/* Evaluate the libc malloc package using the K-best scheme */
 	for (i=0; i < num_tracefiles; i++) {
 	    trace = read_trace(tracedir, tracefiles[i]);
-	    libc_stats[i].ops = trace->num_ops;
+	    libc_stats[i].ops = trace->num_reqs;
 	    if (verbose > 1)
 		printf("Checking libc malloc for correctness, ");
 	    libc_stats[i].valid = eval_libc_valid(trace, i);
@@ -269,7 +405,7 @@ int main(int argc, char **argv)
 	/* Display the libc results in a compact table */
 	if (verbose) {
 	    printf("\nResults for libc malloc:\n");
-	    printresults(num_tracefiles, libc_stats);
+	    printresults(num_tracefiles, tracefiles, libc_stats);
 	}
     }
 
@@ -286,23 +422,33 @@ int main(int argc, char **argv)
     
     /* Initialize the simulated memory system in memlib.c */
     mem_init(); 
+    if (mem_huge_pages_wanted())
+	printf("Heap backed by %s\n",
+	       mem_huge_pages() == MEM_HUGE_TLB ? "hugetlb pages (MAP_HUGETLB)" :
+	       mem_huge_pages() == MEM_HUGE_THP ? "transparent huge pages (MADV_HUGEPAGE)" :
+	       "base pages (no huge page support)");
 
     /* Evaluate student's mm malloc package using the K-best scheme */
     for (i=0; i < num_tracefiles; i++) {
 	trace = read_trace(tracedir, tracefiles[i]);
-	mm_stats[i].ops = trace->num_ops;
+	mm_stats[i].ops = trace->num_reqs;
 	if (verbose > 1)
 	    printf("Checking mm_malloc for correctness, ");
 	mm_stats[i].valid = eval_mm_valid(trace, i, &ranges);
 	if (mm_stats[i].valid) {
 	    if (verbose > 1)
 		printf("efficiency, ");
-	    mm_stats[i].util = eval_mm_util(trace, i, &ranges);
+	    mm_stats[i].util = eval_mm_util(trace, i, &ranges, &mm_stats[i]);
 	    speed_params.trace = trace;
 	    speed_params.ranges = ranges;
 	    if (verbose > 1)
 		printf("and performance.\n");
 	    mm_stats[i].secs = fsecs(eval_mm_speed, &speed_params);
+	    if (run_latency) {
+		if (verbose > 1)
+		    printf("Measuring per-op latency.\n");
+		eval_mm_latency(trace, &mm_stats[i]);
+	    }
 	}
 	free_trace(trace);
     }
@@ -310,7 +456,61 @@ int main(int argc, char **argv)
     /* Display the mm results in a compact table */
     if (verbose) {
 	printf("\nResults for mm malloc:\n");
-	printresults(num_tracefiles, mm_stats);
+	printresults(num_tracefiles, tracefiles, mm_stats);
+	printf("\n");
+    }
+
+    /* Display the worst-case latencies, regardless of verbosity */
+    if (run_latency) {
+	printf("Per-op latency for mm malloc (ns, best of %d replays):\n",
+	       LAT_REPS);
+	printlatency(num_tracefiles, tracefiles, mm_stats);
+	printf("\n");
+    }
+
+    /* Display the footprint over time, regardless of verbosity */
+    if (show_footprint) {
+	printf("Footprint of mm malloc over each trace (KB):\n");
+	printfootprint(num_tracefiles, tracefiles, mm_stats);
+	printf("\n");
+    }
+
+    /* Display the deferred coalescing, regardless of verbosity */
+    if (show_quick) {
+	printf("Deferred coalescing of mm malloc over each trace:\n");
+	printquick(num_tracefiles, tracefiles, mm_stats);
+	printf("\n");
+    }
+
+    /* Display the multithreaded throughput, regardless of verbosity */
+    if (max_threads >= 0) {
+	if (max_threads == 0) /* one thread per online core */
+	    max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (max_threads < 1)
+	    max_threads = 1;
+	if (max_threads > MAX_THREADS)
+	    max_threads = MAX_THREADS;
+	eval_mm_scaling(tracefiles, num_tracefiles, max_threads);
+	printf("\n");
+    }
+
+    /* Display the cross-thread free throughput, regardless of verbosity */
+    if (num_pairs > 0) {
+	if (num_pairs > MAX_THREADS / 2)
+	    num_pairs = MAX_THREADS / 2;
+	eval_mm_prodcons(tracefiles, num_tracefiles, num_pairs);
+	printf("\n");
+    }
+
+    /* Display the object pool comparison, regardless of verbosity */
+    if (run_pool) {
+	eval_mm_pool();
+	printf("\n");
+    }
+
+    /* Display the placement policy comparison, regardless of verbosity */
+    if (run_policies) {
+	eval_mm_policies(tracefiles, num_tracefiles);
 	printf("\n");
     }
 
@@ -395,9 +595,10 @@ static int add_range(range_t **ranges, char *lo, int size,
         return 0;
     }
 
-    /* The payload must lie within the extent of the heap */
-    if ((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
-	(hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) {
+    /* The payload must lie within the extent of the heap or of a mapping */
+    if (((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
+	 (hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) &&
+	!mem_is_mapped(lo, hi)) {
 	sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p)",
 		lo, hi, mem_heap_lo(), mem_heap_hi());
 	malloc_error(tracenum, opnum, msg);
@@ -477,9 +678,11 @@ static trace_t *read_trace(char *tracedir, char *filename)
     trace_t *trace;
     char type[MAXLINE];
     char path[MAXLINE];
-    unsigned index, size;
+    unsigned index, size, align, count, nmemb, j;
     unsigned max_index = 0;
     unsigned op_index;
+    int scope = 0;       /* inside a region scope? */
+    char *scoped_ids;    /* was each id allocated inside a region scope? */
 
     if (verbose > 1)
 	printf("Reading tracefile: %s\n", filename);
@@ -514,17 +717,29 @@ static trace_t *read_trace(char *tracedir, char *filename)
     if ((trace->block_sizes = 
 	 (size_t *)malloc(trace->num_ids * sizeof(size_t))) == NULL)
 	unix_error("malloc 4 failed in read_trace");
+    if ((scoped_ids = (char *)calloc(trace->num_ids, 1)) == NULL)
+	unix_error("calloc failed in read_trace");
     
-    /* read every request line in the trace file */
+    /* 
+     * read every request line in the trace file. block_sizes tracks
+     * the current size of each id, so that each free knows the size of
+     * the block it releases (for -S)
+     */
     index = 0;
     op_index = 0;
+    trace->num_reqs = 0;
+    trace->num_scopes = 0;
     while (fscanf(tracefile, "%s", type) != EOF) {
+	trace->ops[op_index].count = 1;
+	trace->ops[op_index].scoped = 0;
 	switch(type[0]) {
 	case 'a':
 	    fscanf(tracefile, "%u %u", &index, &size);
 	    trace->ops[op_index].type = ALLOC;
 	    trace->ops[op_index].index = index;
 	    trace->ops[op_index].size = size;
+	    trace->ops[op_index].scoped = scoped_ids[index] = scope;
+	    trace->block_sizes[index] = size;
 	    max_index = (index > max_index) ? index : max_index;
 	    break;
 	case 'r':
@@ -532,28 +747,139 @@ static trace_t *read_trace(char *tracedir, char *filename)
 	    trace->ops[op_index].type = REALLOC;
 	    trace->ops[op_index].index = index;
 	    trace->ops[op_index].size = size;
+	    trace->ops[op_index].scoped = scoped_ids[index];
+	    trace->ops[op_index].oldsize = trace->block_sizes[index];
+	    trace->block_sizes[index] = size;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'm':
+	    fscanf(tracefile, "%u %u %u", &index, &align, &size);
+	    trace->ops[op_index].type = MEMALIGN;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
+	    trace->ops[op_index].align = align;
+	    trace->block_sizes[index] = size;
+	    scoped_ids[index] = 0;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'c':
+	    fscanf(tracefile, "%u %u %u", &index, &nmemb, &size);
+	    if (size != 0 && nmemb > INT_MAX / size) {
+		printf("Calloc of %u * %u bytes too large in tracefile %s\n",
+		       nmemb, size, path);
+		exit(1);
+	    }
+	    trace->ops[op_index].type = CALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = nmemb * size;
+	    trace->ops[op_index].nmemb = nmemb;
+	    trace->ops[op_index].elsize = size;
+	    trace->block_sizes[index] = nmemb * size;
+	    scoped_ids[index] = 0;
 	    max_index = (index > max_index) ? index : max_index;
 	    break;
 	case 'f':
 	    fscanf(tracefile, "%ud", &index);
 	    trace->ops[op_index].type = FREE;
 	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = trace->block_sizes[index];
+	    trace->ops[op_index].scoped = scoped_ids[index];
+	    break;
+	case 'A':
+	    fscanf(tracefile, "%u %u %u", &index, &count, &size);
+	    trace->ops[op_index].type = BATCH_ALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].count = count;
+	    trace->ops[op_index].size = size;
+	    for (j = 0;  j < count;  j++)
+		trace->block_sizes[index + j] = size;
+	    index += count - 1;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'F':
+	    fscanf(tracefile, "%u %u", &index, &count);
+	    trace->ops[op_index].type = BATCH_FREE;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].count = count;
+	    break;
+	case 'b': /* a region scope covers no ids */
+	case 'e':
+	    trace->ops[op_index].type = (type[0] == 'b') ? SCOPE_BEGIN : SCOPE_END;
+	    trace->ops[op_index].index = 0;
+	    trace->ops[op_index].count = 0;
+	    scope = (type[0] == 'b');
+	    trace->num_scopes += scope;
 	    break;
 	default:
 	    printf("Bogus type character (%c) in tracefile %s\n", 
 		   type[0], path);
 	    exit(1);
 	}
+	trace->num_reqs += trace->ops[op_index].count;
 	op_index++;
 	
     }
     fclose(tracefile);
+    free(scoped_ids);
     assert(max_index == trace->num_ids - 1);
     assert(trace->num_ops == op_index);
+
+    if (unbatch)
+	unbatch_trace(trace);
     
     return trace;
 }
 
+/*
+ * unbatch_trace - Replace each batch request of the trace by one
+ *     malloc or free request per id, so that a batched trace can be
+ *     compared with the same requests made one call at a time (-b)
+ */
+static void unbatch_trace(trace_t *trace)
+{
+    traceop_t *ops, *op;
+    int i, j, n;
+
+    if (trace->num_reqs == trace->num_ops)
+	return;
+    /* scope markers are ops but no requests */
+    if ((ops = (traceop_t *)malloc((trace->num_reqs + trace->num_ops) * 
+				   sizeof(traceop_t))) == NULL)
+	unix_error("malloc failed in unbatch_trace");
+
+    for (i = 0, n = 0;  i < trace->num_ops;  i++) {
+	op = &trace->ops[i];
+	switch (op->type) {
+	case BATCH_ALLOC:
+	    for (j = 0;  j < op->count;  j++, n++) {
+		ops[n].type = ALLOC;
+		ops[n].index = op->index + j;
+		ops[n].size = op->size;
+		ops[n].count = 1;
+		ops[n].scoped = 0;
+		trace->block_sizes[op->index + j] = op->size;
+	    }
+	    break;
+	case BATCH_FREE:
+	    for (j = 0;  j < op->count;  j++, n++) {
+		ops[n].type = FREE;
+		ops[n].index = op->index + j;
+		ops[n].size = trace->block_sizes[op->index + j];
+		ops[n].count = 1;
+		ops[n].scoped = 0;
+	    }
+	    break;
+	default:
+	    if (op->type != FREE && op->count > 0)
+		trace->block_sizes[op->index] = op->size;
+	    ops[n++] = *op;
+	}
+    }
+    free(trace->ops);
+    trace->ops = ops;
+    trace->num_ops = n;
+}
+
 /*
  * free_trace - Free the trace record and the three arrays it points
  *              to, all of which were allocated in read_trace().
@@ -571,6 +897,77 @@ void free_trace(trace_t *trace)
  * and throughput of the libc and mm malloc packages.
  **********************************************************************/
 
+/*
+ * mm_free_op - Free the block of a free request, by mm_free_sized
+ *     with the size the request recorded if -S asked for it. A block
+ *     of a region scope is left to mm_region_reset instead.
+ */
+static void mm_free_op(traceop_t *op, void *p, mm_region_t *region)
+{
+    if (op->scoped && region != NULL)
+	return;
+    if (free_sized)
+	mm_free_sized(p, op->size);
+    else
+	mm_free(p);
+}
+
+/*
+ * mm_calloc_op - Allocate the block of a calloc request by mm_calloc,
+ *     or by mm_malloc and memset if -Z asked for the naive way
+ */
+static void *mm_calloc_op(traceop_t *op)
+{
+    void *p;
+
+    if (!naive_calloc)
+	return mm_calloc(op->nmemb, op->elsize);
+    if ((p = mm_malloc(op->size)) != NULL)
+	memset(p, 0, op->size);
+    return p;
+}
+
+/*
+ * mm_alloc_op - Allocate the block of an alloc request, from the
+ *     region if the request is in a region scope and -R replays them
+ */
+static void *mm_alloc_op(traceop_t *op, mm_region_t *region)
+{
+    if (op->scoped && region != NULL)
+	return mm_region_alloc(region, op->size);
+    return mm_malloc(op->size);
+}
+
+/*
+ * mm_realloc_op - Resize the block of a realloc request. A region
+ *     block cannot grow in place, so it is copied to a new one.
+ */
+static void *mm_realloc_op(traceop_t *op, void *oldp, mm_region_t *region)
+{
+    void *p;
+
+    if (!op->scoped || region == NULL)
+	return mm_realloc(oldp, op->size);
+    if ((p = mm_region_alloc(region, op->size)) != NULL)
+	memcpy(p, oldp, (op->oldsize < op->size) ? op->oldsize : op->size);
+    return p;
+}
+
+/*
+ * replay_region - Start the replay of a trace with a fresh region,
+ *     or with none if -R is not given or the trace has no scopes
+ */
+static mm_region_t *replay_region(trace_t *trace)
+{
+    mm_region_t *region;
+
+    if (!region_scopes || trace->num_scopes == 0)
+	return NULL;
+    if ((region = mm_region_create()) == NULL)
+	app_error("mm_region_create failed");
+    return region;
+}
+
 /*
  * eval_mm_valid - Check the mm malloc package for correctness
  */
@@ -578,11 +975,13 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 {
     int i, j;
     int index;
+    int count;
     int size;
     int oldsize;
     char *newp;
     char *oldp;
     char *p;
+    mm_region_t *region;
     
     /* Reset the heap and free any records in the range list */
     mem_reset_brk();
@@ -593,6 +992,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	malloc_error(tracenum, 0, "mm_init failed.");
 	return 0;
     }
+    region = replay_region(trace);
 
     /* Interpret each operation in the trace in order */
     for (i = 0;  i < trace->num_ops;  i++) {
@@ -602,9 +1002,29 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_malloc */
+        case MEMALIGN: /* mm_memalign */
+        case CALLOC: /* mm_calloc */
 
 	    /* Call the student's malloc */
-	    if ((p = mm_malloc(size)) == NULL) {
+	    if (trace->ops[i].type == CALLOC) {
+		if ((p = mm_calloc_op(&trace->ops[i])) == NULL) {
+		    malloc_error(tracenum, i, "mm_calloc failed.");
+		    return 0;
+		}
+	    }
+	    else if (trace->ops[i].type == MEMALIGN) {
+		if ((p = mm_memalign(trace->ops[i].align, size)) == NULL) {
+		    malloc_error(tracenum, i, "mm_memalign failed.");
+		    return 0;
+		}
+		if ((size_t)p % trace->ops[i].align != 0) {
+		    sprintf(msg, "mm_memalign payload (%p) not aligned to %d bytes",
+			    p, trace->ops[i].align);
+		    malloc_error(tracenum, i, msg);
+		    return 0;
+		}
+	    }
+	    else if ((p = mm_alloc_op(&trace->ops[i], region)) == NULL) {
 		malloc_error(tracenum, i, "mm_malloc failed.");
 		return 0;
 	    }
@@ -616,6 +1036,17 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	     */ 
 	    if (add_range(ranges, p, size, tracenum, i) == 0)
 		return 0;
+
+	    /* A calloc block must read as zero, though the block it reuses
+	     * was filled below */
+	    if (trace->ops[i].type == CALLOC) {
+		for (j = 0; j < size; j++) {
+		    if (p[j] != 0) {
+			malloc_error(tracenum, i, "mm_calloc did not zero the block");
+			return 0;
+		    }
+		}
+	    }
 	    
 	    /* ADDED: cgw
 	     * fill range with low byte of index.  This will be used later
@@ -633,7 +1064,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    
 	    /* Call the student's realloc */
 	    oldp = trace->blocks[index];
-	    if ((newp = mm_realloc(oldp, size)) == NULL) {
+	    if ((newp = mm_realloc_op(&trace->ops[i], oldp, region)) == NULL) {
 		malloc_error(tracenum, i, "mm_realloc failed.");
 		return 0;
 	    }
@@ -653,7 +1084,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    oldsize = trace->block_sizes[index];
 	    if (size < oldsize) oldsize = size;
 	    for (j = 0; j < oldsize; j++) {
-	      if (newp[j] != (index & 0xFF)) {
+	      if ((unsigned char)newp[j] != (index & 0xFF)) {
 		malloc_error(tracenum, i, "mm_realloc did not preserve the "
 			     "data from old block");
 		return 0;
@@ -671,7 +1102,38 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    /* Remove region from list and call student's free function */
 	    p = trace->blocks[index];
 	    remove_range(ranges, p);
-	    mm_free(p);
+	    mm_free_op(&trace->ops[i], p, region);
+	    break;
+
+        case BATCH_ALLOC: /* mm_malloc_batch */
+
+	    /* The batch fills the block array entries of its ids */
+	    count = trace->ops[i].count;
+	    if (mm_malloc_batch(size, count, (void **)&trace->blocks[index]) != (size_t)count) {
+		malloc_error(tracenum, i, "mm_malloc_batch failed.");
+		return 0;
+	    }
+	    for (j = index;  j < index + count;  j++) {
+		if (add_range(ranges, trace->blocks[j], size, tracenum, i) == 0)
+		    return 0;
+		memset(trace->blocks[j], j & 0xFF, size);
+		trace->block_sizes[j] = size;
+	    }
+	    break;
+
+        case BATCH_FREE: /* mm_free_batch */
+	    count = trace->ops[i].count;
+	    for (j = index;  j < index + count;  j++)
+		remove_range(ranges, trace->blocks[j]);
+	    mm_free_batch((void **)&trace->blocks[index], count);
+	    break;
+
+        case SCOPE_BEGIN:
+	    break;
+
+        case SCOPE_END: /* mm_region_reset */
+	    if (region != NULL)
+		mm_region_reset(region);
 	    break;
 
 	default:
@@ -679,6 +1141,8 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
         }
 
     }
+    if (region != NULL)
+	mm_region_destroy(region);
 
     /* As far as we know, this is a valid malloc package */
     return 1;
@@ -695,29 +1159,43 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
  *   is always the high water mark of the heap. 
  *   
  */
-static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
+static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges,
+			   stats_t *stats)
 {   
-    int i;
+    int i, j;
     int index;
     int size, newsize, oldsize;
-    int max_total_size = 0;
-    int total_size = 0;
+    int count;
+    long max_total_size = 0;   /* long, so traces may pass 2 GB */
+    long total_size = 0;
+    size_t footprint = 0, max_footprint = 0;
+    double sum_footprint = 0, sum_size = 0, sum_rss = 0;
     char *p;
     char *newp, *oldp;
+    mm_region_t *region;
 
     /* initialize the heap and the mm malloc package */
     mem_reset_brk();
     if (mm_init() < 0)
 	app_error("mm_init failed in eval_mm_util");
+    region = replay_region(trace);
 
     for (i = 0;  i < trace->num_ops;  i++) {
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_alloc */
+        case MEMALIGN: /* mm_memalign */
+        case CALLOC: /* mm_calloc */
 	    index = trace->ops[i].index;
 	    size = trace->ops[i].size;
 
-	    if ((p = mm_malloc(size)) == NULL) 
+	    if (trace->ops[i].type == CALLOC)
+		p = mm_calloc_op(&trace->ops[i]);
+	    else if (trace->ops[i].type == MEMALIGN)
+		p = mm_memalign(trace->ops[i].align, size);
+	    else
+		p = mm_alloc_op(&trace->ops[i], region);
+	    if (p == NULL) 
 		app_error("mm_malloc failed in eval_mm_util");
 	    
 	    /* Remember region and size */
@@ -739,7 +1217,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    oldsize = trace->block_sizes[index];
 
 	    oldp = trace->blocks[index];
-	    if ((newp = mm_realloc(oldp,newsize)) == NULL)
+	    if ((newp = mm_realloc_op(&trace->ops[i], oldp, region)) == NULL)
 		app_error("mm_realloc failed in eval_mm_util");
 
 	    /* Remember region and size */
@@ -760,7 +1238,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    size = trace->block_sizes[index];
 	    p = trace->blocks[index];
 	    
-	    mm_free(p);
+	    mm_free_op(&trace->ops[i], p, region);
 	    
 	    /* Keep track of current total size
 	     * of all allocated blocks */
@@ -768,13 +1246,71 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    
 	    break;
 
+        case BATCH_ALLOC: /* mm_malloc_batch */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+	    count = trace->ops[i].count;
+
+	    if (mm_malloc_batch(size, count, (void **)&trace->blocks[index]) != (size_t)count)
+		app_error("mm_malloc_batch failed in eval_mm_util");
+	    for (j = index;  j < index + count;  j++)
+		trace->block_sizes[j] = size;
+
+	    total_size += (long)size * count;
+	    max_total_size = (total_size > max_total_size) ?
+		total_size : max_total_size;
+	    break;
+
+        case BATCH_FREE: /* mm_free_batch */
+	    index = trace->ops[i].index;
+	    count = trace->ops[i].count;
+
+	    mm_free_batch((void **)&trace->blocks[index], count);
+	    for (j = index;  j < index + count;  j++)
+		total_size -= trace->block_sizes[j];
+	    break;
+
+        case SCOPE_BEGIN:
+	    break;
+
+        case SCOPE_END: /* mm_region_reset */
+	    if (region != NULL)
+		mm_region_reset(region);
+	    break;
+
 	default:
 	    app_error("Nonexistent request type in eval_mm_util");
 
         }
+
+	/* 
+	 * The footprint is the heaps of every region (one per arena,
+	 * and any mm regions) plus the blocks mm mapped outside of
+	 * them, which come and go, so keep its peak 
+	 */
+	footprint = mem_total_heapsize() + mem_mapped_size();
+	max_footprint = (footprint > max_footprint) ? footprint : max_footprint;
+	sum_footprint += footprint;
+	sum_size += total_size;
+	if (track_rss) /* mincore is too slow to run on every trace */
+	    sum_rss += mem_resident_size();
     }
 
-    return ((double)max_total_size / (double)mem_heapsize());
+    /* An empty trace has no footprint to average */
+    stats->fp_peak = max_footprint;
+    stats->fp_avg = trace->num_ops ? sum_footprint / trace->num_ops : 0;
+    stats->fp_end = footprint;
+    stats->util_avg = sum_footprint ? sum_size / sum_footprint : 0;
+    if (track_rss) {
+	stats->rss_avg = trace->num_ops ? sum_rss / trace->num_ops : 0;
+	stats->rss_end = mem_resident_size();
+	mem_page_usage(&stats->pages_end, &stats->huge_end);
+    }
+    mm_quick_stats(&stats->quick);
+    if (region != NULL)
+	mm_region_destroy(region);
+
+    return max_footprint ? (double)max_total_size / (double)max_footprint : 0;
 }
 
 
@@ -784,14 +1320,16 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
  */
 static void eval_mm_speed(void *ptr)
 {
-    int i, index, size, newsize;
+    int i, index, size;
     char *p, *newp, *oldp, *block;
     trace_t *trace = ((speed_t *)ptr)->trace;
+    mm_region_t *region;
 
     /* Reset the heap and initialize the mm package */
     mem_reset_brk();
     if (mm_init() < 0) 
 	app_error("mm_init failed in eval_mm_speed");
+    region = replay_region(trace);
 
     /* Interpret each trace request */
     for (i = 0;  i < trace->num_ops;  i++)
@@ -800,16 +1338,30 @@ static void eval_mm_speed(void *ptr)
         case ALLOC: /* mm_malloc */
             index = trace->ops[i].index;
             size = trace->ops[i].size;
-            if ((p = mm_malloc(size)) == NULL)
+            if ((p = mm_alloc_op(&trace->ops[i], region)) == NULL)
 		app_error("mm_malloc error in eval_mm_speed");
             trace->blocks[index] = p;
             break;
 
+        case MEMALIGN: /* mm_memalign */
+            index = trace->ops[i].index;
+            size = trace->ops[i].size;
+            if ((p = mm_memalign(trace->ops[i].align, size)) == NULL)
+		app_error("mm_memalign error in eval_mm_speed");
+            trace->blocks[index] = p;
+            break;
+
+        case CALLOC: /* mm_calloc */
+            index = trace->ops[i].index;
+            if ((p = mm_calloc_op(&trace->ops[i])) == NULL)
+		app_error("mm_calloc error in eval_mm_speed");
+            trace->blocks[index] = p;
+            break;
+
 	case REALLOC: /* mm_realloc */
 	    index = trace->ops[i].index;
-            newsize = trace->ops[i].size;
 	    oldp = trace->blocks[index];
-            if ((newp = mm_realloc(oldp,newsize)) == NULL)
+            if ((newp = mm_realloc_op(&trace->ops[i], oldp, region)) == NULL)
 		app_error("mm_realloc error in eval_mm_speed");
             trace->blocks[index] = newp;
             break;
@@ -817,12 +1369,611 @@ static void eval_mm_speed(void *ptr)
         case FREE: /* mm_free */
             index = trace->ops[i].index;
             block = trace->blocks[index];
-            mm_free(block);
+            mm_free_op(&trace->ops[i], block, region);
+            break;
+
+        case BATCH_ALLOC: /* mm_malloc_batch */
+            index = trace->ops[i].index;
+            size = trace->ops[i].size;
+            if (mm_malloc_batch(size, trace->ops[i].count,
+				(void **)&trace->blocks[index]) != (size_t)trace->ops[i].count)
+		app_error("mm_malloc_batch error in eval_mm_speed");
+            break;
+
+        case BATCH_FREE: /* mm_free_batch */
+            index = trace->ops[i].index;
+            mm_free_batch((void **)&trace->blocks[index], trace->ops[i].count);
+            break;
+
+        case SCOPE_BEGIN:
+            break;
+
+        case SCOPE_END: /* mm_region_reset */
+            if (region != NULL)
+		mm_region_reset(region);
             break;
 
 	default:
 	    app_error("Nonexistent request type in eval_mm_valid");
         }
+    if (region != NULL)
+	mm_region_destroy(region);
+}
+
+/*
+ * op_nsecs - Read a monotonic clock in nanoseconds
+ */
+static double op_nsecs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/*
+ * eval_mm_latency - Measure the latency of every individual mm
+ *    request in the trace. The trace is replayed LAT_REPS times and
+ *    each request keeps the fastest of its replays, which filters out
+ *    interrupts and preemption; the worst of these per-request times
+ *    is the per-op bound reported for each request type.
+ */
+static void eval_mm_latency(trace_t *trace, stats_t *stats)
+{
+    int i, rep, index, type;
+    size_t n;
+    double start, elapsed, total;
+    double *best;
+    char *p;
+
+    if ((best = (double *)malloc(trace->num_ops * sizeof(double))) == NULL)
+	unix_error("malloc failed in eval_mm_latency");
+    for (i = 0;  i < trace->num_ops;  i++)
+	best[i] = DBL_MAX;
+
+    for (rep = 0;  rep < LAT_REPS;  rep++) {
+	mem_reset_brk();
+	if (mm_init() < 0)
+	    app_error("mm_init failed in eval_mm_latency");
+
+	for (i = 0;  i < trace->num_ops;  i++) {
+	    index = trace->ops[i].index;
+	    switch (trace->ops[i].type) {
+
+	    case ALLOC: /* mm_malloc */
+		start = op_nsecs();
+		p = mm_malloc(trace->ops[i].size);
+		elapsed = op_nsecs() - start;
+		if (p == NULL)
+		    app_error("mm_malloc error in eval_mm_latency");
+		trace->blocks[index] = p;
+		break;
+
+	    case MEMALIGN: /* mm_memalign */
+		start = op_nsecs();
+		p = mm_memalign(trace->ops[i].align, trace->ops[i].size);
+		elapsed = op_nsecs() - start;
+		if (p == NULL)
+		    app_error("mm_memalign error in eval_mm_latency");
+		trace->blocks[index] = p;
+		break;
+
+	    case CALLOC: /* mm_calloc */
+		start = op_nsecs();
+		p = mm_calloc_op(&trace->ops[i]);
+		elapsed = op_nsecs() - start;
+		if (p == NULL)
+		    app_error("mm_calloc error in eval_mm_latency");
+		trace->blocks[index] = p;
+		break;
+
+	    case REALLOC: /* mm_realloc */
+		start = op_nsecs();
+		p = mm_realloc(trace->blocks[index], trace->ops[i].size);
+		elapsed = op_nsecs() - start;
+		if (p == NULL)
+		    app_error("mm_realloc error in eval_mm_latency");
+		trace->blocks[index] = p;
+		break;
+
+	    case FREE: /* mm_free */
+		start = op_nsecs();
+		mm_free_op(&trace->ops[i], trace->blocks[index], NULL);
+		elapsed = op_nsecs() - start;
+		break;
+
+	    case BATCH_ALLOC: /* mm_malloc_batch */
+		start = op_nsecs();
+		n = mm_malloc_batch(trace->ops[i].size, trace->ops[i].count,
+				    (void **)&trace->blocks[index]);
+		elapsed = op_nsecs() - start;
+		if (n != (size_t)trace->ops[i].count)
+		    app_error("mm_malloc_batch error in eval_mm_latency");
+		break;
+
+	    case BATCH_FREE: /* mm_free_batch */
+		start = op_nsecs();
+		mm_free_batch((void **)&trace->blocks[index], trace->ops[i].count);
+		elapsed = op_nsecs() - start;
+		break;
+
+	    case SCOPE_BEGIN: /* every block is freed one by one here */
+	    case SCOPE_END:
+		elapsed = 0;
+		break;
+
+	    default:
+		app_error("Nonexistent request type in eval_mm_latency");
+		elapsed = 0;
+	    }
+	    if (elapsed < best[i])
+		best[i] = elapsed;
+	}
+    }
+
+    /* 
+     * Reduce the per-request times to worst case per type and mean.
+     * A memalign or calloc counts as a malloc, and a batch as count mallocs or
+     * frees that took the same time each
+     */
+    stats->lat_max[ALLOC] = stats->lat_max[FREE] = stats->lat_max[REALLOC] = 0;
+    total = 0;
+    for (i = 0;  i < trace->num_ops;  i++) {
+	if (trace->ops[i].count == 0) /* a scope marker */
+	    continue;
+	switch (trace->ops[i].type) {
+	case MEMALIGN: case CALLOC: case BATCH_ALLOC: type = ALLOC; break;
+	case BATCH_FREE: type = FREE; break;
+	default: type = trace->ops[i].type;
+	}
+	if (best[i] / trace->ops[i].count > stats->lat_max[type])
+	    stats->lat_max[type] = best[i] / trace->ops[i].count;
+	total += best[i];
+    }
+    stats->lat_avg = total / trace->num_reqs;
+    free(best);
+}
+
+/*
+ * scale_thread - One thread of the thread scaling run: replay every
+ *    trace SCALE_REPS times against mm, using a private block array
+ *    so that threads never touch each other's blocks. Blocks still
+ *    allocated at the end of a replay are freed, so unbalanced traces
+ *    do not grow the heap from one replay to the next.
+ */
+static void *scale_thread(void *ptr)
+{
+    scale_t *sp = (scale_t *)ptr;
+    trace_t *trace;
+    char **blocks;
+    int rep, t, i, index;
+
+    for (rep = 0;  rep < SCALE_REPS;  rep++) {
+	for (t = 0;  t < sp->num_traces;  t++) {
+	    trace = sp->traces[t];
+	    blocks = sp->blocks[t];
+	    for (i = 0;  i < trace->num_ops;  i++) {
+		index = trace->ops[i].index;
+		switch (trace->ops[i].type) {
+
+		case ALLOC: /* mm_malloc */
+		    if ((blocks[index] = mm_malloc(trace->ops[i].size)) == NULL)
+			app_error("mm_malloc error in eval_mm_scaling");
+		    break;
+
+		case MEMALIGN: /* mm_memalign */
+		    blocks[index] = mm_memalign(trace->ops[i].align, trace->ops[i].size);
+		    if (blocks[index] == NULL)
+			app_error("mm_memalign error in eval_mm_scaling");
+		    break;
+
+		case CALLOC: /* mm_calloc */
+		    if ((blocks[index] = mm_calloc_op(&trace->ops[i])) == NULL)
+			app_error("mm_calloc error in eval_mm_scaling");
+		    break;
+
+		case REALLOC: /* mm_realloc */
+		    blocks[index] = mm_realloc(blocks[index], trace->ops[i].size);
+		    if (blocks[index] == NULL)
+			app_error("mm_realloc error in eval_mm_scaling");
+		    break;
+
+		case FREE: /* mm_free */
+		    mm_free_op(&trace->ops[i], blocks[index], NULL);
+		    blocks[index] = NULL;
+		    break;
+
+		case BATCH_ALLOC: /* mm_malloc_batch */
+		    if (mm_malloc_batch(trace->ops[i].size, trace->ops[i].count,
+					(void **)&blocks[index]) != (size_t)trace->ops[i].count)
+			app_error("mm_malloc_batch error in eval_mm_scaling");
+		    break;
+
+		case BATCH_FREE: /* mm_free_batch */
+		    mm_free_batch((void **)&blocks[index], trace->ops[i].count);
+		    memset(&blocks[index], 0, trace->ops[i].count * sizeof(char *));
+		    break;
+
+		case SCOPE_BEGIN: /* every block is freed one by one here */
+		case SCOPE_END:
+		    break;
+
+		default:
+		    app_error("Nonexistent request type in eval_mm_scaling");
+		}
+	    }
+	    for (i = 0;  i < trace->num_ids;  i++) {
+		mm_free(blocks[i]);
+		blocks[i] = NULL;
+	    }
+	}
+    }
+    return NULL;
+}
+
+/*
+ * eval_mm_scaling - Measure the aggregate throughput of mm when 1, 2,
+ *    ..., max_threads threads each replay all of the traces at once,
+ *    and print it together with the speedup over a single thread.
+ */
+static void eval_mm_scaling(char **tracefiles, int num_tracefiles, 
+			    int max_threads)
+{
+    trace_t **traces;
+    scale_t *params;
+    pthread_t tid[MAX_THREADS];
+    double start, secs, ops, base = 0;
+    int i, t, n;
+
+    if ((traces = (trace_t **)malloc(num_tracefiles * sizeof(trace_t *))) == NULL)
+	unix_error("malloc failed in eval_mm_scaling");
+    if ((params = (scale_t *)calloc(max_threads, sizeof(scale_t))) == NULL)
+	unix_error("calloc failed in eval_mm_scaling");
+
+    ops = 0;
+    for (i = 0;  i < num_tracefiles;  i++) {
+	traces[i] = read_trace(tracedir, tracefiles[i]);
+	ops += traces[i]->num_reqs;
+    }
+    ops *= SCALE_REPS;
+
+    for (t = 0;  t < max_threads;  t++) {
+	params[t].traces = traces;
+	params[t].num_traces = num_tracefiles;
+	if ((params[t].blocks = (char ***)malloc(num_tracefiles * sizeof(char **))) == NULL)
+	    unix_error("malloc failed in eval_mm_scaling");
+	for (i = 0;  i < num_tracefiles;  i++) 
+	    if ((params[t].blocks[i] = (char **)calloc(traces[i]->num_ids, sizeof(char *))) == NULL)
+		unix_error("calloc failed in eval_mm_scaling");
+    }
+
+    printf("Thread scaling for mm malloc (%d replays of all traces per thread):\n",
+	   SCALE_REPS);
+    printf("%7s%10s%10s%10s\n", "threads", "secs", "Kops", "speedup");
+    for (n = 1;  n <= max_threads;  n++) {
+	mem_reset_brk();
+	if (mm_init() < 0)
+	    app_error("mm_init failed in eval_mm_scaling");
+
+	start = op_nsecs();
+	for (t = 0;  t < n;  t++)
+	    if (pthread_create(&tid[t], NULL, scale_thread, &params[t]) != 0)
+		app_error("pthread_create failed in eval_mm_scaling");
+	for (t = 0;  t < n;  t++)
+	    pthread_join(tid[t], NULL);
+	secs = (op_nsecs() - start) / 1e9;
+
+	if (n == 1)
+	    base = ops / secs;
+	printf("%7d%10.6f%10.0f%10.2f\n", 
+	       n, secs, (n * ops) / (secs * 1e3), (n * ops / secs) / base);
+    }
+
+    for (t = 0;  t < max_threads;  t++) {
+	for (i = 0;  i < num_tracefiles;  i++)
+	    free(params[t].blocks[i]);
+	free(params[t].blocks);
+    }
+    for (i = 0;  i < num_tracefiles;  i++)
+	free_trace(traces[i]);
+    free(params);
+    free(traces);
+}
+
+/*
+ * eval_mm_policies - Replay every trace under each placement policy of
+ *    mm, and print the utilization and throughput of each side by side,
+ *    with the performance index each policy would get.
+ */
+static void eval_mm_policies(char **tracefiles, int num_tracefiles)
+{
+    stats_t *stats, *st;
+    trace_t *trace;
+    range_t *ranges = NULL;
+    speed_t speed_params;
+    double util[MM_NUM_POLICIES], ops[MM_NUM_POLICIES], secs[MM_NUM_POLICIES], thru;
+    int i, p, valid[MM_NUM_POLICIES];
+
+    if ((stats = (stats_t *)calloc(num_tracefiles * MM_NUM_POLICIES, sizeof(stats_t))) == NULL)
+	unix_error("calloc failed in eval_mm_policies");
+
+    for (i = 0;  i < num_tracefiles;  i++) {
+	trace = read_trace(tracedir, tracefiles[i]);
+	for (p = 0;  p < MM_NUM_POLICIES;  p++) {
+	    st = &stats[i * MM_NUM_POLICIES + p];
+	    mm_set_policy(p);
+	    st->ops = trace->num_reqs;
+	    st->valid = eval_mm_valid(trace, i, &ranges);
+	    if (st->valid) {
+		st->util = eval_mm_util(trace, i, &ranges, st);
+		speed_params.trace = trace;
+		speed_params.ranges = ranges;
+		st->secs = fsecs(eval_mm_speed, &speed_params);
+	    }
+	}
+	free_trace(trace);
+    }
+    clear_ranges(&ranges);
+
+    printf("Placement policies of mm malloc (util, Kops):\n");
+    printf("%5s %-20s", "trace", "name");
+    for (p = 0;  p < MM_NUM_POLICIES;  p++)
+	printf("%14s", mm_policy_name(p));
+    printf("\n");
+    for (i = 0;  i < num_tracefiles;  i++) {
+	printf("%2d    %-20s", i, tracefiles[i]);
+	for (p = 0;  p < MM_NUM_POLICIES;  p++) {
+	    st = &stats[i * MM_NUM_POLICIES + p];
+	    if (st->valid)
+		printf("%5.0f%%%8.0f", st->util * 100.0, (st->ops / 1e3) / st->secs);
+	    else
+		printf("%6s%8s", "-", "-");
+	}
+	printf("\n");
+    }
+
+    /* The totals and the performance index, as for the main results */
+    for (p = 0;  p < MM_NUM_POLICIES;  p++) {
+	util[p] = ops[p] = secs[p] = 0;
+	valid[p] = 1;
+	for (i = 0;  i < num_tracefiles;  i++) {
+	    st = &stats[i * MM_NUM_POLICIES + p];
+	    valid[p] &= st->valid;
+	    util[p] += st->util / num_tracefiles;
+	    ops[p] += st->ops;
+	    secs[p] += st->secs;
+	}
+    }
+    printf("%-26s", "Total");
+    for (p = 0;  p < MM_NUM_POLICIES;  p++) {
+	if (valid[p])
+	    printf("%5.0f%%%8.0f", util[p] * 100.0, (ops[p] / 1e3) / secs[p]);
+	else
+	    printf("%6s%8s", "-", "-");
+    }
+    printf("\n%-26s", "Perf index");
+    for (p = 0;  p < MM_NUM_POLICIES;  p++) {
+	thru = ops[p] / secs[p];
+	if (thru > AVG_LIBC_THRUPUT)
+	    thru = AVG_LIBC_THRUPUT;
+	if (valid[p])
+	    printf("%14.0f", (UTIL_WEIGHT * util[p] +
+			      (1.0 - UTIL_WEIGHT) * thru / AVG_LIBC_THRUPUT) * 100.0);
+	else
+	    printf("%14s", "-");
+    }
+    printf("\n");
+    free(stats);
+}
+
+/*
+ * pc_put - Wait for a free slot in the ring, then publish block p
+ */
+static void pc_put(pc_t *pc, char *p)
+{
+    while (pc->tail - __atomic_load_n(&pc->head, __ATOMIC_ACQUIRE) == PC_RING)
+	sched_yield();
+    pc->ring[pc->tail % PC_RING] = p;
+    __atomic_store_n(&pc->tail, pc->tail + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * producer_thread - Malloc every ALLOC, MEMALIGN and CALLOC request of the
+ *    traces, SCALE_REPS times over, and pass the blocks to the
+ *    consumer. A NULL block marks the end of the stream.
+ */
+static void *producer_thread(void *ptr)
+{
+    pc_t *pc = (pc_t *)ptr;
+    trace_t *trace;
+    char *p;
+    int rep, t, i;
+
+    for (rep = 0;  rep < SCALE_REPS;  rep++) {
+	for (t = 0;  t < pc->num_traces;  t++) {
+	    trace = pc->traces[t];
+	    for (i = 0;  i < trace->num_ops;  i++) {
+		if (trace->ops[i].type == ALLOC)
+		    p = mm_malloc(trace->ops[i].size);
+		else if (trace->ops[i].type == MEMALIGN)
+		    p = mm_memalign(trace->ops[i].align, trace->ops[i].size);
+		else if (trace->ops[i].type == CALLOC)
+		    p = mm_calloc_op(&trace->ops[i]);
+		else
+		    continue;
+		if (p == NULL)
+		    app_error("mm_malloc error in eval_mm_prodcons");
+		pc_put(pc, p);
+	    }
+	}
+    }
+    pc_put(pc, NULL);
+    return NULL;
+}
+
+/*
+ * consumer_thread - Free every block the producer passes until NULL
+ */
+static void *consumer_thread(void *ptr)
+{
+    pc_t *pc = (pc_t *)ptr;
+    char *p;
+
+    for (;;) {
+	while (__atomic_load_n(&pc->tail, __ATOMIC_ACQUIRE) == pc->head)
+	    sched_yield();
+	p = pc->ring[pc->head % PC_RING];
+	__atomic_store_n(&pc->head, pc->head + 1, __ATOMIC_RELEASE);
+	if (p == NULL)
+	    return NULL;
+	mm_free(p);
+    }
+}
+
+/*
+ * eval_mm_prodcons - Measure the throughput of mm when every block is
+ *    freed by a different thread than the one that malloced it:
+ *    num_pairs producer threads malloc the ALLOC, MEMALIGN and CALLOC requests
+ *    of all the traces and num_pairs consumer threads free them.
+ */
+static void eval_mm_prodcons(char **tracefiles, int num_tracefiles, 
+			     int num_pairs)
+{
+    trace_t **traces;
+    pc_t *pcs;
+    pthread_t prod[MAX_THREADS / 2], cons[MAX_THREADS / 2];
+    double start, secs, ops;
+    int i, t;
+
+    if ((traces = (trace_t **)malloc(num_tracefiles * sizeof(trace_t *))) == NULL)
+	unix_error("malloc failed in eval_mm_prodcons");
+    if ((pcs = (pc_t *)calloc(num_pairs, sizeof(pc_t))) == NULL)
+	unix_error("calloc failed in eval_mm_prodcons");
+
+    ops = 0;
+    for (i = 0;  i < num_tracefiles;  i++) {
+	traces[i] = read_trace(tracedir, tracefiles[i]);
+	for (t = 0;  t < traces[i]->num_ops;  t++)
+	    if (traces[i]->ops[t].type == ALLOC || traces[i]->ops[t].type == MEMALIGN ||
+		traces[i]->ops[t].type == CALLOC)
+		ops += 2; /* one malloc and one free */
+    }
+    ops *= SCALE_REPS * num_pairs;
+
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in eval_mm_prodcons");
+
+    start = op_nsecs();
+    for (t = 0;  t < num_pairs;  t++) {
+	pcs[t].traces = traces;
+	pcs[t].num_traces = num_tracefiles;
+	if (pthread_create(&prod[t], NULL, producer_thread, &pcs[t]) != 0 ||
+	    pthread_create(&cons[t], NULL, consumer_thread, &pcs[t]) != 0)
+	    app_error("pthread_create failed in eval_mm_prodcons");
+    }
+    for (t = 0;  t < num_pairs;  t++) {
+	pthread_join(prod[t], NULL);
+	pthread_join(cons[t], NULL);
+    }
+    secs = (op_nsecs() - start) / 1e9;
+
+    printf("Producer/consumer for mm malloc (%d pairs, %d replays of all traces):\n",
+	   num_pairs, SCALE_REPS);
+    printf("%7s%10s%10s\n", "pairs", "secs", "Kops");
+    printf("%7d%10.6f%10.0f\n", num_pairs, secs, ops / (secs * 1e3));
+
+    for (i = 0;  i < num_tracefiles;  i++)
+	free_trace(traces[i]);
+    free(pcs);
+    free(traces);
+}
+
+/*
+ * pool_run - One run of the pool benchmark: allocate POOL_OBJS objects
+ *    of size bytes, free every other one and allocate those again, then
+ *    free them all, from an mm_pool or with mm_malloc/mm_free. Returns
+ *    the seconds it took, and sets *footprint to the heap plus mapped
+ *    bytes while all the objects were live.
+ */
+static double pool_run(int size, int use_pool, char **objs, size_t *footprint)
+{
+    mm_pool_t *pool = NULL;
+    double start;
+    int i;
+
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in eval_mm_pool");
+
+    start = op_nsecs();
+    if (use_pool && (pool = mm_pool_create(size, 0)) == NULL)
+	app_error("mm_pool_create failed in eval_mm_pool");
+    for (i = 0;  i < POOL_OBJS;  i++) {
+	objs[i] = use_pool ? mm_pool_alloc(pool) : mm_malloc(size);
+	if (objs[i] == NULL)
+	    app_error("allocation failed in eval_mm_pool");
+	objs[i][0] = (char)i; /* as a constructor would */
+    }
+    for (i = 0;  i < POOL_OBJS;  i += 2) {
+	if (use_pool)
+	    mm_pool_free(pool, objs[i]);
+	else
+	    mm_free(objs[i]);
+    }
+    for (i = 0;  i < POOL_OBJS;  i += 2) {
+	objs[i] = use_pool ? mm_pool_alloc(pool) : mm_malloc(size);
+	if (objs[i] == NULL)
+	    app_error("allocation failed in eval_mm_pool");
+	objs[i][0] = (char)i;
+    }
+    *footprint = mem_total_heapsize() + mem_mapped_size();
+    for (i = 0;  i < POOL_OBJS;  i++) {
+	if (use_pool)
+	    mm_pool_free(pool, objs[i]);
+	else
+	    mm_free(objs[i]);
+    }
+    if (use_pool)
+	mm_pool_destroy(pool);
+    return (op_nsecs() - start) / 1e9;
+}
+
+/*
+ * eval_mm_pool - Compare the throughput and footprint of mm_pool with
+ *    those of mm_malloc for a few typical object sizes.
+ */
+static void eval_mm_pool(void)
+{
+    static int sizes[] = {16, 40, 72, 136, 264, 1000};
+    char **objs;
+    double secs, best[2], ops;
+    size_t footprint[2];
+    int i, p, rep;
+
+    if ((objs = (char **)malloc(POOL_OBJS * sizeof(char *))) == NULL)
+	unix_error("malloc failed in eval_mm_pool");
+    ops = 3.0 * POOL_OBJS; /* POOL_OBJS allocs, then frees and allocs of
+			      half of them, then POOL_OBJS frees */
+
+    printf("Object pool vs mm_malloc (%d objects, best of %d runs):\n",
+	   POOL_OBJS, POOL_REPS);
+    printf("%7s%11s%11s%10s%10s\n", "size", "pool Kops", "mm Kops",
+	   "pool KB", "mm KB");
+    for (i = 0;  i < (int)(sizeof(sizes) / sizeof(sizes[0]));  i++) {
+	for (p = 0;  p < 2;  p++) {
+	    best[p] = DBL_MAX;
+	    for (rep = 0;  rep < POOL_REPS;  rep++) {
+		secs = pool_run(sizes[i], p == 0, objs, &footprint[p]);
+		if (secs < best[p])
+		    best[p] = secs;
+	    }
+	}
+	printf("%7d%11.0f%11.0f%10.0f%10.0f\n", sizes[i],
+	       ops / (best[0] * 1e3), ops / (best[1] * 1e3),
+	       footprint[0] / 1024.0, footprint[1] / 1024.0);
+    }
+    free(objs);
 }
 
 /*
@@ -833,7 +1984,7 @@ static void eval_mm_speed(void *ptr)
  */
 static int eval_libc_valid(trace_t *trace, int tracenum)
 {
-    int i, newsize;
+    int i, j, newsize;
     char *p, *newp, *oldp;
 
     for (i = 0;  i < trace->num_ops;  i++) {
@@ -847,6 +1998,23 @@ static int eval_libc_valid(trace_t *trace, int tracenum)
 	    trace->blocks[trace->ops[i].index] = p;
 	    break;
 
+        case MEMALIGN: /* posix_memalign */
+	    if (posix_memalign((void **)&p, trace->ops[i].align,
+			       trace->ops[i].size) != 0) {
+		malloc_error(tracenum, i, "libc posix_memalign failed");
+		unix_error("System message");
+	    }
+	    trace->blocks[trace->ops[i].index] = p;
+	    break;
+
+        case CALLOC: /* calloc */
+	    if ((p = calloc(trace->ops[i].nmemb, trace->ops[i].elsize)) == NULL) {
+		malloc_error(tracenum, i, "libc calloc failed");
+		unix_error("System message");
+	    }
+	    trace->blocks[trace->ops[i].index] = p;
+	    break;
+
 	case REALLOC: /* realloc */
             newsize = trace->ops[i].size;
 	    oldp = trace->blocks[trace->ops[i].index];
@@ -861,6 +2029,25 @@ static int eval_libc_valid(trace_t *trace, int tracenum)
 	    free(trace->blocks[trace->ops[i].index]);
 	    break;
 
+        case BATCH_ALLOC: /* one malloc per id */
+	    for (j = 0;  j < trace->ops[i].count;  j++) {
+		if ((p = malloc(trace->ops[i].size)) == NULL) {
+		    malloc_error(tracenum, i, "libc malloc failed");
+		    unix_error("System message");
+		}
+		trace->blocks[trace->ops[i].index + j] = p;
+	    }
+	    break;
+
+        case BATCH_FREE: /* one free per id */
+	    for (j = 0;  j < trace->ops[i].count;  j++)
+		free(trace->blocks[trace->ops[i].index + j]);
+	    break;
+
+        case SCOPE_BEGIN: /* libc has no regions */
+        case SCOPE_END:
+	    break;
+
 	default:
 	    app_error("invalid operation type  in eval_libc_valid");
 	}
@@ -876,7 +2063,7 @@ static int eval_libc_valid(trace_t *trace, int tracenum)
  */
 static void eval_libc_speed(void *ptr)
 {
-    int i;
+    int i, j;
     int index, size, newsize;
     char *p, *newp, *oldp, *block;
     trace_t *trace = ((speed_t *)ptr)->trace;
@@ -891,6 +2078,21 @@ static void eval_libc_speed(void *ptr)
 	    trace->blocks[index] = p;
 	    break;
 
+        case MEMALIGN: /* posix_memalign */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+	    if (posix_memalign((void **)&p, trace->ops[i].align, size) != 0)
+		unix_error("posix_memalign failed in eval_libc_speed");
+	    trace->blocks[index] = p;
+	    break;
+
+        case CALLOC: /* calloc */
+	    index = trace->ops[i].index;
+	    if ((p = calloc(trace->ops[i].nmemb, trace->ops[i].elsize)) == NULL)
+		unix_error("calloc failed in eval_libc_speed");
+	    trace->blocks[index] = p;
+	    break;
+
 	case REALLOC: /* realloc */
 	    index = trace->ops[i].index;
 	    newsize = trace->ops[i].size;
@@ -906,6 +2108,26 @@ static void eval_libc_speed(void *ptr)
 	    block = trace->blocks[index];
 	    free(block);
 	    break;
+
+        case BATCH_ALLOC: /* one malloc per id */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+	    for (j = 0;  j < trace->ops[i].count;  j++) {
+		if ((p = malloc(size)) == NULL)
+		    unix_error("malloc failed in eval_libc_speed");
+		trace->blocks[index + j] = p;
+	    }
+	    break;
+
+        case BATCH_FREE: /* one free per id */
+	    index = trace->ops[i].index;
+	    for (j = 0;  j < trace->ops[i].count;  j++)
+		free(trace->blocks[index + j]);
+	    break;
+
+        case SCOPE_BEGIN: /* libc has no regions */
+        case SCOPE_END:
+	    break;
 	}
     }
 }
@@ -916,9 +2138,11 @@ static void eval_libc_speed(void *ptr)
 
 
 /*
- * printresults - prints a performance summary for some malloc package
+ * printresults - prints a performance summary for some malloc package.
+ *     Each row is labeled with its tracefile name so that per-trace
+ *     throughput can be compared across allocator versions.
  */
-static void printresults(int n, stats_t *stats) 
+static void printresults(int n, char **tracefiles, stats_t *stats) 
 {
     int i;
     double secs = 0;
@@ -926,12 +2150,13 @@ static void printresults(int n, stats_t *stats)
     double util = 0;
 
     /* Print the individual results for each trace */
-    printf("%5s%7s %5s%8s%10s%6s\n", 
-	   "trace", " valid", "util", "ops", "secs", "Kops");
+    printf("%5s %-20s%7s %5s%8s%10s%8s\n", 
+	   "trace", "name", " valid", "util", "ops", "secs", "Kops");
     for (i=0; i < n; i++) {
 	if (stats[i].valid) {
-	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f\n", 
+	    printf("%2d    %-20s%7s%5.0f%%%8.0f%10.6f%8.0f\n", 
 		   i,
+		   tracefiles[i],
 		   "yes",
 		   stats[i].util*100.0,
 		   stats[i].ops,
@@ -942,8 +2167,9 @@ static void printresults(int n, stats_t *stats)
 	    util += stats[i].util;
 	}
 	else {
-	    printf("%2d%10s%6s%8s%10s%6s\n", 
+	    printf("%2d    %-20s%7s%6s%8s%10s%8s\n", 
 		   i,
+		   tracefiles[i],
 		   "no",
 		   "-",
 		   "-",
@@ -954,16 +2180,16 @@ static void printresults(int n, stats_t *stats)
 
     /* Print the aggregate results for the set of traces */
     if (errors == 0) {
-	printf("%12s%5.0f%%%8.0f%10.6f%6.0f\n", 
-	       "Total       ",
+	printf("%-33s%5.0f%%%8.0f%10.6f%8.0f\n", 
+	       "Total",
 	       (util/n)*100.0,
 	       ops, 
 	       secs,
 	       (ops/1e3)/secs);
     }
     else {
-	printf("%12s%6s%8s%10s%6s\n", 
-	       "Total       ",
+	printf("%-33s%6s%8s%10s%8s\n", 
+	       "Total",
 	       "-", 
 	       "-", 
 	       "-", 
@@ -972,6 +2198,107 @@ static void printresults(int n, stats_t *stats)
 
 }
 
+/*
+ * printlatency - prints the per-op latency measured by eval_mm_latency
+ */
+static void printlatency(int n, char **tracefiles, stats_t *stats)
+{
+    int i;
+    double worst[3] = {0, 0, 0};
+
+    printf("%5s %-20s%10s%10s%10s%10s\n",
+	   "trace", "name", "malloc", "free", "realloc", "avg");
+    for (i=0; i < n; i++) {
+	if (stats[i].valid) {
+	    printf("%2d    %-20s%10.0f%10.0f%10.0f%10.1f\n",
+		   i,
+		   tracefiles[i],
+		   stats[i].lat_max[ALLOC],
+		   stats[i].lat_max[FREE],
+		   stats[i].lat_max[REALLOC],
+		   stats[i].lat_avg);
+	    worst[ALLOC] = (stats[i].lat_max[ALLOC] > worst[ALLOC]) ?
+		stats[i].lat_max[ALLOC] : worst[ALLOC];
+	    worst[FREE] = (stats[i].lat_max[FREE] > worst[FREE]) ?
+		stats[i].lat_max[FREE] : worst[FREE];
+	    worst[REALLOC] = (stats[i].lat_max[REALLOC] > worst[REALLOC]) ?
+		stats[i].lat_max[REALLOC] : worst[REALLOC];
+	}
+	else {
+	    printf("%2d    %-20s%10s%10s%10s%10s\n",
+		   i, tracefiles[i], "-", "-", "-", "-");
+	}
+    }
+    printf("%-26s%10.0f%10.0f%10.0f\n",
+	   "Worst", worst[ALLOC], worst[FREE], worst[REALLOC]);
+}
+
+/*
+ * printfootprint - prints the footprint measured by eval_mm_util. The
+ *    mean and end columns and the time-averaged utilization show how
+ *    much memory is held between the peaks, which trimming reduces;
+ *    the rss columns show how much of it is really resident, which
+ *    releasing the pages of free blocks reduces.
+ */
+static void printfootprint(int n, char **tracefiles, stats_t *stats)
+{
+    int i;
+
+    printf("%5s %-20s%10s%10s%10s%9s%10s%10s%7s%6s\n",
+	   "trace", "name", "peak", "mean", "end", "avgutil", "rss", "rss-end",
+	   "pages", "huge");
+    for (i=0; i < n; i++) {
+	if (stats[i].valid) {
+	    printf("%2d    %-20s%10.1f%10.1f%10.1f%8.0f%%%10.1f%10.1f%7lu%6lu\n",
+		   i,
+		   tracefiles[i],
+		   stats[i].fp_peak / 1024,
+		   stats[i].fp_avg / 1024,
+		   stats[i].fp_end / 1024,
+		   stats[i].util_avg * 100.0,
+		   stats[i].rss_avg / 1024,
+		   stats[i].rss_end / 1024,
+		   (unsigned long)stats[i].pages_end,
+		   (unsigned long)stats[i].huge_end);
+	}
+	else {
+	    printf("%2d    %-20s%10s%10s%10s%9s%10s%10s%7s%6s\n",
+		   i, tracefiles[i], "-", "-", "-", "-", "-", "-", "-", "-");
+	}
+    }
+}
+
+/*
+ * printquick - prints the quick list and thread cache counters measured
+ *    by eval_mm_util. Each reused block is a free that was not coalesced
+ *    and a malloc that did not split a free block; merged counts the
+ *    deferred frees that were coalesced after all, in batches.
+ */
+static void printquick(int n, char **tracefiles, stats_t *stats)
+{
+    int i;
+
+    printf("%5s %-20s%10s%10s%8s%10s%10s\n",
+	   "trace", "name", "deferred", "reused", "saved", "batches", "merged");
+    for (i=0; i < n; i++) {
+	if (stats[i].valid) {
+	    printf("%2d    %-20s%10lu%10lu%7.0f%%%10lu%10lu\n",
+		   i,
+		   tracefiles[i],
+		   (unsigned long)stats[i].quick.frees,
+		   (unsigned long)stats[i].quick.hits,
+		   stats[i].quick.frees ?
+		   100.0 * stats[i].quick.hits / stats[i].quick.frees : 0.0,
+		   (unsigned long)stats[i].quick.consolidations,
+		   (unsigned long)stats[i].quick.consolidated);
+	}
+	else {
+	    printf("%2d    %-20s%10s%10s%8s%10s%10s\n",
+		   i, tracefiles[i], "-", "-", "-", "-", "-");
+	}
+    }
+}
+
 /* 
  * app_error - Report an arbitrary application error
  */
@@ -1004,14 +2331,28 @@ void malloc_error(int tracenum, int opnum, char *msg)
  */
 static void usage(void) 
 {
-    fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>]\n");
+    fprintf(stderr, "Usage: mdriver [-hvVabBFglLOQRSZ] [-f <file>] [-t <dir>] [-m <size>] [-H <size>] [-P <n>] [-T <n>] [-U]\n");
     fprintf(stderr, "Options\n");
     fprintf(stderr, "\t-a         Don't check the team structure.\n");
+    fprintf(stderr, "\t-b         Replay batch requests one block at a time.\n");
+    fprintf(stderr, "\t-B         Back the heap with huge pages (implies -U).\n");
     fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
+    fprintf(stderr, "\t-F         Compare the placement policies of mm malloc.\n");
     fprintf(stderr, "\t-g         Generate summary info for autograder.\n");
     fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-H <size>  Let the heap grow to <size> bytes (K, M, G suffix).\n");
     fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-L         Report worst-case per-op latency of mm malloc.\n");
+    fprintf(stderr, "\t-m <size>  Have mm map requests of at least <size> bytes.\n");
+    fprintf(stderr, "\t-O         Compare mm_pool with mm_malloc for a few object sizes.\n");
+    fprintf(stderr, "\t-P <n>     Report mm throughput with <n> producer/consumer pairs.\n");
+    fprintf(stderr, "\t-Q         Report the coalescing mm deferred (quick lists, tcache).\n");
+    fprintf(stderr, "\t-R         Free the blocks of region scopes with mm_region_reset.\n");
+    fprintf(stderr, "\t-S         Free blocks with mm_free_sized.\n");
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
+    fprintf(stderr, "\t-T <n>     Report mm throughput from 1 to <n> threads (0 = cores).\n");
+    fprintf(stderr, "\t-U         Report the mm footprint over each trace.\n");
     fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
     fprintf(stderr, "\t-V         Print additional debug info.\n");
+    fprintf(stderr, "\t-Z         Replay calloc requests as mm_malloc and memset.\n");
 }
@@ -2,7 +2,41 @@
  * memlib.c - a module that simulates the memory system.  Needed because it 
  *            allows us to interleave calls from the student's malloc package 
  *            with the system's malloc package in libc.
+ *
+ *            The model supports any number of independent brk regions,
+ *            so that a malloc package can give each of its arenas or
+ *            heaps a brk of its own. The mem_* routines operate on the
+ *            default region, which mem_init creates; further regions
+ *            come from mem_region_create, are reset by mem_region_reset
+ *            and are released by mem_region_destroy.
+ *
+ *            Apart from the brk regions, mem_map hands out a private
+ *            mapping per call, which mem_unmap returns to the system
+ *            right away. This models the mmap path of a real malloc.
+ *
+ *            Every region is reserved with mmap as PROT_NONE address
+ *            space and committed a step at a time as its brk advances,
+ *            so neither the reservation nor startup cost depends on how
+ *            large the region may grow. The limit of the default region
+ *            (and of the arenas a malloc package adds) is MAX_HEAP
+ *            unless mem_set_heap_limit or the MM_HEAP_LIMIT environment
+ *            variable says otherwise. Pages only become resident when
+ *            they are touched. Pages given up by a shrinking brk or by
+ *            mem_release_pages go back to the system, and
+ *            mem_resident_size reports what is resident.
+ *
+ *            With mem_set_huge_pages (or MM_HUGE_PAGES=1 in the
+ *            environment) the regions are backed by 2 MB pages instead:
+ *            MAP_HUGETLB pages if the system has a pool of them, else
+ *            transparent huge pages asked for with MADV_HUGEPAGE, else
+ *            plain pages. Regions are then reserved, committed and
+ *            released in whole huge pages. mem_page_usage reports how
+ *            many pages of each size the regions use.
+ *
+ *            Nothing on the allocation path calls malloc or stdio, so
+ *            memlib can back a malloc that replaces libc's (libmm.so).
  */
+#define _GNU_SOURCE  /* for mremap */
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -10,28 +44,301 @@
 #include <sys/mman.h>
 #include <string.h>
 #include <errno.h>
+#include <ctype.h>
+#include <pthread.h>
 
 #include "memlib.h"
 #include "config.h"
 
+/* One simulated brk region */
+struct mem_region {
+    char *start_brk;  /* points to first byte of heap */
+    char *brk;        /* points to last byte of heap */
+    char *max_addr;   /* largest legal heap address */ 
+    char *commit;     /* end of the committed (read/write) part */
+    size_t reserved;  /* bytes of address space reserved */
+    int huge;         /* MEM_HUGE_* backing of this region */
+    struct mem_region *prev, *next;  /* list of all live regions */
+};
+
+/* Header at the start of every mapping made by mem_map */
+typedef struct mem_mapping {
+    size_t len;                        /* bytes mapped, header included */
+    struct mem_mapping *prev, *next;   /* list of all live mappings */
+} mem_mapping_t;
+
+/* A region's brk commits address space at least this much at a time */
+#define COMMIT_SIZE (256 * 1024)
+
+/* Size of the huge pages asked for by mem_set_huge_pages */
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/* Bytes from the start of a mapping to the address mem_map returns */
+#define MAP_HDR_SIZE ((sizeof(mem_mapping_t) + 15) & ~(size_t)15)
+
+#define MAPPING(p) ((mem_mapping_t *)((char *)(p) - MAP_HDR_SIZE))
+
 /* private variables */
-static char *mem_start_brk;  /* points to first byte of heap */
-static char *mem_brk;        /* points to last byte of heap */
-static char *mem_max_addr;   /* largest legal heap address */ 
+static mem_region_t default_region;       /* used by the mem_* routines */
+static mem_region_t *regions = NULL;      /* all live regions */
+static pthread_mutex_t region_lock = PTHREAD_MUTEX_INITIALIZER;
+static mem_mapping_t *mappings = NULL;    /* all live mappings */
+static size_t mapped_bytes = 0;           /* total length of the mappings */
+static pthread_mutex_t map_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t heap_limit = 0;             /* 0 until set or read from the environment */
+static int huge_wanted = -1;              /* -1 until set or read from the environment */
+static int huge_mode = MEM_HUGE_OFF;      /* best backing mem_init found */
+
+/*
+ * mem_error - print msg on stderr. It goes straight to write(2), since
+ *    stdio may call malloc, and memlib may be what backs malloc.
+ */
+static void mem_error(const char *msg)
+{
+    if (write(STDERR_FILENO, msg, strlen(msg)) < 0)
+	return;
+}
+
+/*
+ * page_round - round size up to a whole number of pages
+ */
+static size_t page_round(size_t size)
+{
+    size_t pagesize = mem_pagesize();
+
+    return (size + pagesize - 1) & ~(pagesize - 1);
+}
+
+/*
+ * grain_round - round size up to a whole number of the pages that
+ *    back regions, huge ones if huge pages are on
+ */
+static size_t grain_round(size_t size)
+{
+    if (huge_mode == MEM_HUGE_OFF)
+	return page_round(size);
+    return (size + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+}
+
+/*
+ * huge_probe - find the best huge page backing the system offers
+ */
+static int huge_probe(void)
+{
+    void *p;
+    int mode = MEM_HUGE_OFF;
+
+    p = mmap(NULL, HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+	     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+	munmap(p, HUGE_PAGE_SIZE);
+	return MEM_HUGE_TLB;
+    }
+    p = mmap(NULL, HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+	     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+	return MEM_HUGE_OFF;
+    if (madvise(p, HUGE_PAGE_SIZE, MADV_HUGEPAGE) == 0)
+	mode = MEM_HUGE_THP;
+    munmap(p, HUGE_PAGE_SIZE);
+    return mode;
+}
+
+/*
+ * region_reserve - reserve len bytes of address space for region r,
+ *    with the backing huge_mode asks for, falling back to the next
+ *    best one. Returns NULL if the address space is not there.
+ */
+static char *region_reserve(mem_region_t *r, size_t len)
+{
+    char *p, *start;
+
+    r->huge = huge_mode;
+    if (r->huge == MEM_HUGE_TLB) {
+	/* no MAP_NORESERVE: a short pool should fail here, not SIGBUS later */
+	p = mmap(NULL, len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (p != MAP_FAILED)
+	    return p;
+	r->huge = MEM_HUGE_THP;
+    }
+    if (r->huge == MEM_HUGE_OFF) {
+	p = mmap(NULL, len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	return p == MAP_FAILED ? NULL : p;
+    }
+
+    /* THP: reserve a huge page more, so the region can start on a boundary */
+    p = mmap(NULL, len + HUGE_PAGE_SIZE, PROT_NONE,
+	     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED)
+	return NULL;
+    start = (char *)(((size_t)p + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1));
+    if (start > p)
+	munmap(p, start - p);
+    munmap(start + len, p + HUGE_PAGE_SIZE - start);
+    if (madvise(start, len, MADV_HUGEPAGE) < 0)
+	r->huge = MEM_HUGE_OFF;
+    return start;
+}
+
+/*
+ * region_init - reserve the address space for a region of size bytes
+ *    and add it to the region list. Nothing is committed yet. Returns
+ *    -1 if the address space is not there.
+ */
+static int region_init(mem_region_t *r, size_t size)
+{
+    /* reserve the storage we will use to model the available VM */
+    r->reserved = grain_round(size);
+    if ((r->start_brk = region_reserve(r, r->reserved)) == NULL)
+	return -1;
+
+    r->max_addr = r->start_brk + size;  /* max legal heap address */
+    r->brk = r->start_brk;              /* heap is empty initially */
+    r->commit = r->start_brk;           /* and nothing is committed */
+
+    pthread_mutex_lock(&region_lock);
+    r->prev = NULL;
+    r->next = regions;
+    if (regions != NULL)
+	regions->prev = r;
+    regions = r;
+    pthread_mutex_unlock(&region_lock);
+    return 0;
+}
+
+/*
+ * region_commit - make region r readable and writable up to at least
+ *    end, COMMIT_SIZE (or a huge page) at a time. Returns -1 if the
+ *    system says no.
+ */
+static int region_commit(mem_region_t *r, char *end)
+{
+    char *limit = r->start_brk + r->reserved;
+    size_t len;
+
+    if (end <= r->commit)
+	return 0;
+    len = grain_round(end - r->commit);
+    if (len < COMMIT_SIZE)
+	len = COMMIT_SIZE;
+    if (len > (size_t)(limit - r->commit))
+	len = limit - r->commit;
+    if (mprotect(r->commit, len, PROT_READ | PROT_WRITE) < 0)
+	return -1;
+    r->commit += len;
+    return 0;
+}
+
+/*
+ * region_deinit - remove region r from the region list and free its storage
+ */
+static void region_deinit(mem_region_t *r)
+{
+    pthread_mutex_lock(&region_lock);
+    if (r->prev != NULL)
+	r->prev->next = r->next;
+    else
+	regions = r->next;
+    if (r->next != NULL)
+	r->next->prev = r->prev;
+    pthread_mutex_unlock(&region_lock);
+    munmap(r->start_brk, r->reserved);
+}
 
 /* 
  * mem_init - initialize the memory system model
  */
 void mem_init(void)
 {
-    /* allocate the storage we will use to model the available VM */
-    if ((mem_start_brk = (char *)malloc(MAX_HEAP)) == NULL) {
-	fprintf(stderr, "mem_init_vm: malloc error\n");
+    if (mem_huge_pages_wanted())
+	huge_mode = huge_probe();
+    if (region_init(&default_region, mem_heap_limit()) < 0) {
+	mem_error("mem_init_vm: mmap error\n");
 	exit(1);
     }
+}
+
+/*
+ * mem_set_huge_pages - ask for huge page backed regions (on nonzero).
+ *    Call it before mem_init.
+ */
+void mem_set_huge_pages(int on)
+{
+    huge_wanted = on != 0;
+}
+
+/*
+ * mem_huge_pages_wanted - the setting of mem_set_huge_pages, else
+ *    whether MM_HUGE_PAGES is set to something other than 0
+ */
+int mem_huge_pages_wanted(void)
+{
+    char *s;
+
+    if (huge_wanted < 0)
+	huge_wanted = (s = getenv("MM_HUGE_PAGES")) != NULL && strcmp(s, "0") != 0;
+    return huge_wanted;
+}
+
+/*
+ * mem_huge_pages - the MEM_HUGE_* backing the default region got
+ */
+int mem_huge_pages(void)
+{
+    return default_region.huge;
+}
+
+/*
+ * mem_huge_page_size - size of the pages backing the regions: a huge
+ *    page if huge pages are on, else 0
+ */
+size_t mem_huge_page_size(void)
+{
+    return huge_mode == MEM_HUGE_OFF ? 0 : HUGE_PAGE_SIZE;
+}
+
+/*
+ * mem_parse_size - parse a byte count with an optional K, M or G
+ *    suffix. Returns 0 if s is not one.
+ */
+size_t mem_parse_size(const char *s)
+{
+    char *end;
+    unsigned long long n = strtoull(s, &end, 10);
+
+    switch (toupper((unsigned char)*end)) {
+    case 'G': n <<= 10; /* fall through */
+    case 'M': n <<= 10; /* fall through */
+    case 'K': n <<= 10; end++; break;
+    }
+    if (end == s || *end != '\0')
+	return 0;
+    return (size_t)n;
+}
 
-    mem_max_addr = mem_start_brk + MAX_HEAP;  /* max legal heap address */
-    mem_brk = mem_start_brk;                  /* heap is empty initially */
+/*
+ * mem_set_heap_limit - set how far the default region and every region
+ *    created after it with mem_heap_limit() may grow. Call it before
+ *    mem_init for the default region to see it.
+ */
+void mem_set_heap_limit(size_t size)
+{
+    heap_limit = size;
+}
+
+/*
+ * mem_heap_limit - the limit set by mem_set_heap_limit, else the one
+ *    in the MM_HEAP_LIMIT environment variable, else MAX_HEAP
+ */
+size_t mem_heap_limit(void)
+{
+    char *s;
+
+    if (heap_limit == 0) {
+	if ((s = getenv("MM_HEAP_LIMIT")) == NULL || (heap_limit = mem_parse_size(s)) == 0)
+	    heap_limit = MAX_HEAP;
+    }
+    return heap_limit;
 }
 
 /* 
@@ -39,7 +346,9 @@ void mem_init(void)
  */
 void mem_deinit(void)
 {
-    free(mem_start_brk);
+    while (regions != NULL)
+	mem_region_destroy(regions);
+    mem_unmap_all();
 }
 
 /*
@@ -47,25 +356,21 @@ void mem_deinit(void)
  */
 void mem_reset_brk()
 {
-    mem_brk = mem_start_brk;
+    mem_region_reset(&default_region);
 }
 
 /* 
  * mem_sbrk - simple model of the sbrk function. Extends the heap 
- *    by incr bytes and returns the start address of the new area. In
- *    this model, the heap cannot be shrunk.
+ *    by incr bytes and returns the start address of the new area. A
+ *    negative incr shrinks the heap, but never below its first byte.
  */
 void *mem_sbrk(int incr) 
 {
-    char *old_brk = mem_brk;
+    void *p = mem_region_sbrk(&default_region, incr);
 
-    if ( (incr < 0) || ((mem_brk + incr) > mem_max_addr)) {
-	errno = ENOMEM;
-	fprintf(stderr, "ERROR: mem_sbrk failed. Ran out of memory...\n");
-	return (void *)-1;
-    }
-    mem_brk += incr;
-    return (void *)old_brk;
+    if (p == (void *)-1 && errno == ENOMEM)
+	mem_error("ERROR: mem_sbrk failed. Ran out of memory...\n");
+    return p;
 }
 
 /*
@@ -73,7 +378,7 @@ void *mem_sbrk(int incr)
  */
 void *mem_heap_lo()
 {
-    return (void *)mem_start_brk;
+    return mem_region_lo(&default_region);
 }
 
 /* 
@@ -81,7 +386,7 @@ void *mem_heap_lo()
  */
 void *mem_heap_hi()
 {
-    return (void *)(mem_brk - 1);
+    return mem_region_hi(&default_region);
 }
 
 /*
@@ -89,7 +394,7 @@ void *mem_heap_hi()
  */
 size_t mem_heapsize() 
 {
-    return (size_t)(mem_brk - mem_start_brk);
+    return mem_region_size(&default_region);
 }
 
 /*
@@ -99,3 +404,408 @@ size_t mem_pagesize()
 {
     return (size_t)getpagesize();
 }
+
+/*
+ * mem_default_region - return the region used by the mem_* routines
+ */
+mem_region_t *mem_default_region(void)
+{
+    return &default_region;
+}
+
+/*
+ * mem_region_create - create another empty brk region that can grow to
+ *    size bytes. Returns NULL if there is no memory for it.
+ */
+mem_region_t *mem_region_create(size_t size)
+{
+    mem_region_t *r;
+
+    /* not malloc: memlib may be what backs malloc (see libmm.c) */
+    if ((r = (mem_region_t *)mem_reserve(sizeof(mem_region_t))) == NULL)
+	return NULL;
+    if (region_init(r, size) < 0) {
+	mem_unreserve(r, sizeof(mem_region_t));
+	return NULL;
+    }
+    return r;
+}
+
+/*
+ * mem_region_destroy - release region r and all of its storage at once
+ */
+void mem_region_destroy(mem_region_t *r)
+{
+    region_deinit(r);
+    if (r != &default_region)
+	mem_unreserve(r, sizeof(mem_region_t));
+}
+
+/* 
+ * mem_region_sbrk - mem_sbrk on region r. Running out of memory only
+ *    sets errno to ENOMEM: a full region is routine for the allocator
+ *    (it moves on to another arena), so it is left to the caller to
+ *    report once every region has failed.
+ */
+void *mem_region_sbrk(mem_region_t *r, int incr) 
+{
+    char *old_brk = r->brk;
+
+    if ((incr < 0) && ((r->brk + incr) < r->start_brk)) {
+	errno = EINVAL;
+	mem_error("ERROR: mem_sbrk failed. Shrank below the heap start...\n");
+	return (void *)-1;
+    }
+    if ((r->brk + incr) > r->max_addr || region_commit(r, r->brk + incr) < 0) {
+	errno = ENOMEM;
+	return (void *)-1;
+    }
+    r->brk += incr;
+    if (incr < 0) /* like sbrk, give the pages above the new brk back */
+	mem_release_pages(r->brk, (char *)grain_round((size_t)old_brk));
+    return (void *)old_brk;
+}
+
+/*
+ * mem_region_reset - reset the brk pointer of region r to make an empty heap
+ */
+void mem_region_reset(mem_region_t *r)
+{
+    mem_release_pages(r->start_brk, (char *)grain_round((size_t)r->brk));
+    r->brk = r->start_brk;
+}
+
+/*
+ * mem_region_lo - return address of the first byte of region r
+ */
+void *mem_region_lo(mem_region_t *r)
+{
+    return (void *)r->start_brk;
+}
+
+/* 
+ * mem_region_hi - return address of last heap byte of region r
+ */
+void *mem_region_hi(mem_region_t *r)
+{
+    return (void *)(r->brk - 1);
+}
+
+/*
+ * mem_region_size - returns the heap size of region r in bytes
+ */
+size_t mem_region_size(mem_region_t *r)
+{
+    return (size_t)(r->brk - r->start_brk);
+}
+
+/*
+ * mem_region_limit - how many bytes region r may grow to
+ */
+size_t mem_region_limit(mem_region_t *r)
+{
+    return (size_t)(r->max_addr - r->start_brk);
+}
+
+/*
+ * mem_total_heapsize - returns the heap size summed over all regions
+ */
+size_t mem_total_heapsize(void)
+{
+    mem_region_t *r;
+    size_t total = 0;
+
+    pthread_mutex_lock(&region_lock);
+    for (r = regions; r != NULL; r = r->next)
+	total += mem_region_size(r);
+    pthread_mutex_unlock(&region_lock);
+    return total;
+}
+
+/*
+ * map_link - add mapping m to the list of live mappings
+ */
+static void map_link(mem_mapping_t *m)
+{
+    pthread_mutex_lock(&map_lock);
+    m->prev = NULL;
+    m->next = mappings;
+    if (mappings != NULL)
+	mappings->prev = m;
+    mappings = m;
+    mapped_bytes += m->len;
+    pthread_mutex_unlock(&map_lock);
+}
+
+/*
+ * map_unlink - remove mapping m from the list of live mappings
+ */
+static void map_unlink(mem_mapping_t *m)
+{
+    pthread_mutex_lock(&map_lock);
+    if (m->prev != NULL)
+	m->prev->next = m->next;
+    else
+	mappings = m->next;
+    if (m->next != NULL)
+	m->next->prev = m->prev;
+    mapped_bytes -= m->len;
+    pthread_mutex_unlock(&map_lock);
+}
+
+/*
+ * map_len - bytes to map for a usable size of size, rounded to pages,
+ *    or 0 if that does not fit in a size_t
+ */
+static size_t map_len(size_t size)
+{
+    if (size > (size_t)-1 - MAP_HDR_SIZE - mem_pagesize())
+	return 0;
+    return page_round(size + MAP_HDR_SIZE);
+}
+
+/*
+ * mem_map - map a private region with at least size usable bytes.
+ *    Returns a 16-byte aligned address, or NULL if the system says no.
+ */
+void *mem_map(size_t size)
+{
+    mem_mapping_t *m;
+    size_t len = map_len(size);
+
+    if (len == 0)
+	return NULL;
+    m = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m == MAP_FAILED)
+	return NULL;
+    m->len = len;
+    map_link(m);
+    return (char *)m + MAP_HDR_SIZE;
+}
+
+/*
+ * mem_remap - grow or shrink the mapping at p to at least size usable
+ *    bytes, moving it if need be. The contents are kept. Returns the
+ *    new address, or NULL (with p still mapped) if the system says no.
+ */
+void *mem_remap(void *p, size_t size)
+{
+    mem_mapping_t *m = MAPPING(p);
+    size_t len = map_len(size);
+
+    if (len == 0)
+	return NULL;
+    if (len == m->len)
+	return p;
+    map_unlink(m);
+    if ((m = mremap(m, m->len, len, MREMAP_MAYMOVE)) == MAP_FAILED) {
+	map_link(MAPPING(p));
+	return NULL;
+    }
+    m->len = len;
+    map_link(m);
+    return (char *)m + MAP_HDR_SIZE;
+}
+
+/*
+ * mem_unmap - return the mapping at p to the system
+ */
+void mem_unmap(void *p)
+{
+    mem_mapping_t *m = MAPPING(p);
+
+    map_unlink(m);
+    munmap(m, m->len);
+}
+
+/*
+ * mem_unmap_all - return every live mapping to the system
+ */
+void mem_unmap_all(void)
+{
+    while (mappings != NULL)
+	mem_unmap((char *)mappings + MAP_HDR_SIZE);
+}
+
+/*
+ * mem_map_size - usable bytes of the mapping at p
+ */
+size_t mem_map_size(void *p)
+{
+    return MAPPING(p)->len - MAP_HDR_SIZE;
+}
+
+/*
+ * mem_mapped_size - bytes currently mapped by mem_map, headers and
+ *    page rounding included
+ */
+size_t mem_mapped_size(void)
+{
+    return mapped_bytes;
+}
+
+/*
+ * mem_is_mapped - is [lo, hi] inside the usable part of one live mapping?
+ */
+int mem_is_mapped(void *lo, void *hi)
+{
+    mem_mapping_t *m;
+    int found = 0;
+
+    pthread_mutex_lock(&map_lock);
+    for (m = mappings; m != NULL && !found; m = m->next)
+	found = (char *)lo >= (char *)m + MAP_HDR_SIZE && 
+	    (char *)hi < (char *)m + m->len;
+    pthread_mutex_unlock(&map_lock);
+    return found;
+}
+
+/*
+ * mem_prefork - take memlib's locks before a fork, so that no other
+ *    thread is in the middle of changing the region or mapping lists
+ */
+void mem_prefork(void)
+{
+    pthread_mutex_lock(&region_lock);
+    pthread_mutex_lock(&map_lock);
+}
+
+/*
+ * mem_postfork - release the locks mem_prefork took, in the parent and
+ *    in the child
+ */
+void mem_postfork(void)
+{
+    pthread_mutex_unlock(&map_lock);
+    pthread_mutex_unlock(&region_lock);
+}
+
+/*
+ * mem_reserve - zero-filled storage of size bytes for a malloc package's
+ *    own bookkeeping, kept apart from every region and mapping. Its
+ *    pages only become resident when they are touched. Returns NULL if
+ *    the system says no.
+ */
+void *mem_reserve(size_t size)
+{
+    void *p = mmap(NULL, page_round(size), PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    return p == MAP_FAILED ? NULL : p;
+}
+
+/*
+ * mem_unreserve - return storage of size bytes from mem_reserve
+ */
+void mem_unreserve(void *p, size_t size)
+{
+    munmap(p, page_round(size));
+}
+
+/*
+ * mem_release_pages - give the physical pages wholly inside [lo, hi)
+ *    back to the system. The addresses stay valid and read as zero
+ *    the next time they are touched.
+ */
+void mem_release_pages(void *lo, void *hi)
+{
+    size_t pagesize = huge_mode == MEM_HUGE_OFF ? mem_pagesize() : HUGE_PAGE_SIZE;
+    char *start = (char *)grain_round((size_t)lo);
+    char *end = (char *)((size_t)hi & ~(pagesize - 1));
+
+    if (start < end)
+	madvise(start, end - start, MADV_DONTNEED);
+}
+
+/*
+ * resident_pages - number of resident pages in [lo, hi), lo page aligned
+ */
+static size_t resident_pages(char *lo, char *hi)
+{
+    unsigned char vec[4096];
+    size_t pagesize = mem_pagesize();
+    size_t i, n, count = 0;
+
+    while (lo < hi) {
+	n = (page_round(hi - lo)) / pagesize;
+	if (n > sizeof(vec))
+	    n = sizeof(vec);
+	if (mincore(lo, n * pagesize, vec) == 0)
+	    for (i = 0; i < n; i++)
+		count += vec[i] & 1;
+	lo += n * pagesize;
+    }
+    return count;
+}
+
+/*
+ * mem_resident_size - bytes of all regions and mappings that are
+ *    actually resident in physical memory, as reported by mincore.
+ *    Pages above a region's brk are never resident, so only the
+ *    heaps themselves are scanned.
+ */
+size_t mem_resident_size(void)
+{
+    mem_region_t *r;
+    mem_mapping_t *m;
+    size_t pages = 0;
+
+    pthread_mutex_lock(&region_lock);
+    for (r = regions; r != NULL; r = r->next)
+	pages += resident_pages(r->start_brk, (char *)page_round((size_t)r->brk));
+    pthread_mutex_unlock(&region_lock);
+
+    pthread_mutex_lock(&map_lock);
+    for (m = mappings; m != NULL; m = m->next)
+	pages += resident_pages((char *)m, (char *)m + m->len);
+    pthread_mutex_unlock(&map_lock);
+    return pages * mem_pagesize();
+}
+
+/*
+ * in_region - does [lo, hi) lie in the reservation of a live region?
+ *    Called with region_lock held.
+ */
+static int in_region(size_t lo, size_t hi)
+{
+    mem_region_t *r;
+
+    for (r = regions; r != NULL; r = r->next)
+	if (lo >= (size_t)r->start_brk && hi <= (size_t)r->start_brk + r->reserved)
+	    return 1;
+    return 0;
+}
+
+/*
+ * mem_page_usage - how many base pages and huge pages back the regions
+ *    right now, as /proc/self/smaps tells. Both are 0 if it can't.
+ */
+void mem_page_usage(size_t *pages, size_t *huge_pages)
+{
+    FILE *fp;
+    char line[256];
+    unsigned long lo, hi;
+    size_t kb, rss_kb = 0, thp_kb = 0, tlb_kb = 0;
+    int ours = 0;
+
+    *pages = *huge_pages = 0;
+    if ((fp = fopen("/proc/self/smaps", "r")) == NULL)
+	return;
+    pthread_mutex_lock(&region_lock);
+    while (fgets(line, sizeof(line), fp) != NULL) {
+	if (sscanf(line, "%lx-%lx ", &lo, &hi) == 2)
+	    ours = in_region(lo, hi);
+	else if (!ours)
+	    continue;
+	else if (sscanf(line, "Rss: %zu kB", &kb) == 1)
+	    rss_kb += kb;
+	else if (sscanf(line, "AnonHugePages: %zu kB", &kb) == 1)
+	    thp_kb += kb;
+	else if (sscanf(line, "Private_Hugetlb: %zu kB", &kb) == 1)
+	    tlb_kb += kb;
+    }
+    pthread_mutex_unlock(&region_lock);
+    fclose(fp);
+    *pages = (rss_kb - thp_kb) * 1024 / mem_pagesize();
+    *huge_pages = (thp_kb + tlb_kb) * 1024 / HUGE_PAGE_SIZE;
+}
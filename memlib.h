@@ -1,5 +1,13 @@
 #include <unistd.h>
 
+/* Backing of the regions (see mem_set_huge_pages) */
+#define MEM_HUGE_OFF 0   /* base pages */
+#define MEM_HUGE_THP 1   /* transparent huge pages (MADV_HUGEPAGE) */
+#define MEM_HUGE_TLB 2   /* hugetlb pages (MAP_HUGETLB) */
+
+/* An independent simulated brk region (see mem_region_create) */
+typedef struct mem_region mem_region_t;
+
 void mem_init(void);               
 void mem_deinit(void);
 void *mem_sbrk(int incr);
@@ -8,4 +16,37 @@ void *mem_heap_lo(void);
 void *mem_heap_hi(void);
 size_t mem_heapsize(void);
 size_t mem_pagesize(void);
+size_t mem_parse_size(const char *s);
+void mem_set_heap_limit(size_t size);
+size_t mem_heap_limit(void);
+void mem_set_huge_pages(int on);
+int mem_huge_pages_wanted(void);
+int mem_huge_pages(void);
+size_t mem_huge_page_size(void);
+void mem_page_usage(size_t *pages, size_t *huge_pages);
+
+mem_region_t *mem_default_region(void);
+mem_region_t *mem_region_create(size_t size);
+void mem_region_destroy(mem_region_t *r);
+void *mem_region_sbrk(mem_region_t *r, int incr);
+void mem_region_reset(mem_region_t *r);
+void *mem_region_lo(mem_region_t *r);
+void *mem_region_hi(mem_region_t *r);
+size_t mem_region_size(mem_region_t *r);
+size_t mem_region_limit(mem_region_t *r);
+size_t mem_total_heapsize(void);
+
+void *mem_map(size_t size);
+void *mem_remap(void *p, size_t size);
+void mem_unmap(void *p);
+void mem_unmap_all(void);
+size_t mem_map_size(void *p);
+size_t mem_mapped_size(void);
+int mem_is_mapped(void *lo, void *hi);
 
+void mem_prefork(void);
+void mem_postfork(void);
+void *mem_reserve(size_t size);
+void mem_unreserve(void *p, size_t size);
+void mem_release_pages(void *lo, void *hi);
+size_t mem_resident_size(void);
@@ -1,22 +1,44 @@
 /*
- * mm-naive.c - The fastest, least memory-efficient malloc package.
- * 
- * In this naive approach, a block is allocated by simply incrementing
- * the brk pointer.  A block is pure payload. There are no headers or
- * footers.  Blocks are never coalesced or reused. Realloc is
- * implemented directly using mm_malloc and mm_free.
+ * mm.c - 분리 가용 리스트(segregated free list) 기반 malloc 패키지.
  *
- * NOTE TO STUDENTS: Replace this header comment with your own header
- * comment that gives a high level description of your solution.
+ * 블록 구조는 header/footer 경계 태그(boundary tag)를 그대로 사용하고,
+ * 가용 블록의 payload 앞부분에 이전/다음 가용 블록 포인터(pred/succ)를
+ * 저장해 이중 연결 리스트를 만든다. 리스트는 크기 클래스별로 나뉘어
+ * 있으며(작은 크기는 정확한 크기, 그 위로는 2의 거듭제곱 구간),
+ * 비어있지 않은 클래스를 비트맵으로 기록해 맞는 클래스를 O(1)에 고른다.
+ *
+ *   가용 블록:  [header | pred | succ | ... | footer]
+ *   할당 블록:  [header | payload ..................]
+ *
+ * 할당 블록에는 footer 가 없다. 대신 모든 header 의 두 번째 비트(PREV_ALLOC)에
+ * 바로 앞 블록의 할당 여부를 기록하고, coalesce 는 이 비트가 앞 블록이
+ * free 라고 할 때만 앞 블록의 footer 를 읽는다.
+ *
+ * mmap_threshold 이상의 큰 요청은 힙에 넣지 않고 블록마다 따로 매핑(mem_map)해서
+ * free 할 때 바로 시스템에 돌려준다.
+ *
+ * 64바이트 이하의 작은 요청은 슬랩이 맡는다. 페이지 크기의 run 하나에
+ * 같은 크기 오브젝트만 header 없이 채우고, 사용 여부는 run 의 비트맵으로 관리한다.
+ *
+ * 힙은 여러 아레나로 나뉜다. 아레나마다 자기 brk 영역과 가용 리스트, 슬랩, 락을
+ * 따로 가지며, 스레드는 라운드 로빈으로 아레나 하나에 배정된다. 작은 크기는
+ * 스레드별 캐시(tcache)가 락 없이 먼저 처리한다.
+ *
+ * 각 리스트는 LIFO 순서로 관리한다. free/coalesce/extend_heap 으로 새로 생긴
+ * 가용 블록은 항상 자기 크기 클래스 리스트 맨 앞에 들어가고, place 에서 할당되거나
+ * coalesce 에서 병합되는 블록은 리스트에서 빠진다.
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <unistd.h>
 #include <string.h>
+#include <limits.h>
+#include <pthread.h>
 
 #include "mm.h"
 #include "memlib.h"
+#include "config.h"
 
 /*********************************************************
  * NOTE TO STUDENTS: Before you do anything else, please
@@ -36,223 +58,2423 @@ team_t team = {
 };
 
 /*   기본 매크로 설정   */
+//  블록 레이아웃. MM_LAYOUT64 를 정의하면 8바이트 워드 + 16바이트 정렬(64비트 프로세스용),
+//  아니면 4바이트 워드 + 8바이트 정렬. ALIGNMENT 는 드라이버와 같이 쓰도록 config.h 에 있다
+#ifdef MM_LAYOUT64
+#define WSIZE 8  //  워드 크기. 헤더나 푸터 한 개의 크기. 블록 크기를 64비트로 담는다
+typedef unsigned long long word_t;  //  header/footer 한 워드
+#else
 #define WSIZE 4  //  워드 크기. 헤더나 푸터 한 개의 크기. 보통 4바이트 (32비트)
-#define DSIZE 8  //  더블 워드 크기. 페이로드 정렬을 위해 최소 블록 크기로 사용. 보통 8바이트 (밑에 ALIGN과 관련이 있는지 알아볼 것)
+typedef unsigned int word_t;
+#endif
+#define DSIZE (2 * WSIZE)  //  더블 워드 크기 = ALIGNMENT. prologue 블록 크기이자 블록 크기의 단위
 #define CHUNKSIZE (1 << 12)  //  초기 힙 확장 단위. 힙을 확장할 때 한 번에 이만큼 요청. 일반적으로 4096 바이트 (4KB)
+#ifndef RELEASE_THRESHOLD
+#define RELEASE_THRESHOLD (64 * 1024)  //  이 크기 이상의 free 블록은 안쪽의 온전한 페이지를 시스템에 돌려준다
+#endif
+#ifndef TRIM_THRESHOLD
+#define TRIM_THRESHOLD (64 * 1024)  //  힙 꼭대기의 free 블록이 이만큼 커지면 CHUNKSIZE 만 남기고 brk 를 줄인다
+#endif
 
 
 #define MAX(x, y) ((x) > (y) ? (x) : (y))
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
 
 #define PACK(size, alloc) ((size) | (alloc))  //  블록의 크기와 할당 상태(0또는 1)를 하나의 값으로 포장. 하위 비트를 alloc에 사용
+#define PREV_ALLOC 0x2  //  header 의 두 번째 비트: 바로 앞 블록이 할당 상태인지 (할당 블록은 footer 가 없으므로 여기에 기록)
 
-#define GET(p) (*(unsigned int *)(p))  // 포인터 p가 가리키는 메모리에서 워드 단위 값 읽기
-#define PUT(p, val) (*(unsigned int *)(p) = (val))  //  포인터 p가 가리키는 메모리에 워드 단위 값 쓰기
+#define GET(p) (*(word_t *)(p))  // 포인터 p가 가리키는 메모리에서 워드 단위 값 읽기
+#define PUT(p, val) (*(word_t *)(p) = (val))  //  포인터 p가 가리키는 메모리에 워드 단위 값 쓰기
 
 #define GET_SIZE(p) (GET(p) & ~0x7)  //  블록 크기 추출 (하위 3비트 제거)
 #define GET_ALLOC(p) (GET(p) & 0x1)  //  할당 여부 추출 (하위 1비트 확인)
+#define GET_PREV_ALLOC(p) (GET(p) & PREV_ALLOC)  //  앞 블록 할당 여부 추출
+#define MAPPED 0x4  //  header 의 세 번째 비트: 힙 밖에서 mem_map 으로 따로 받은 블록
+
+//  p 는 할당 블록의 header 일 수 있고, 다른 아레나 락을 잡은 스레드가 락 없이 그 크기를 읽으므로(mm_free) 원자적으로 바꾼다
+#define SET_PREV_ALLOC(p) __atomic_fetch_or((word_t *)(p), PREV_ALLOC, __ATOMIC_RELAXED)   //  header p 의 앞 블록 할당 비트 켜기
+#define CLR_PREV_ALLOC(p) __atomic_fetch_and((word_t *)(p), ~(word_t)PREV_ALLOC, __ATOMIC_RELAXED)  //  header p 의 앞 블록 할당 비트 끄기
+#define GET_SIZE_UNLOCKED(p) (__atomic_load_n((word_t *)(p), __ATOMIC_RELAXED) & ~0x7)  //  락 없이 읽는 할당 블록 크기
 
 #define HDRP(bp) ((char *)(bp) - WSIZE)  // bp는 payload 포인터. 이 매크로는 해당 블록의 헤더 주소 계산
-#define FTRP(bp) ((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE)  // bp 기준으로 footer의 주소 계산. 전체 블록 크기에서 8바이트 빼는 이유는 헤더 + footer 포함했기 떄문
+#define FTRP(bp) ((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE)  // bp 기준으로 footer의 주소 계산. footer 는 free 블록에만 있다
 
 #define NEXT_BLKP(bp) ((char *)(bp) + GET_SIZE(((char *)(bp) - WSIZE)))  //  현재 블록 기준으로 다음 블록의 payload 주소 계산
-#define PREV_BLKP(bp) ((char *)(bp) - GET_SIZE(((char *)(bp) - DSIZE)))  //  현재 블록 기준으로 이전 블록의 payload 주소 계산
+#define PREV_BLKP(bp) ((char *)(bp) - GET_SIZE(((char *)(bp) - DSIZE)))  //  이전 블록의 payload 주소 계산. 이전 블록이 free 일 때만(footer 가 있을 때만) 쓸 수 있다
 /*   기본 매크로 설정   */
 
-/* single word (4) or double word (8) alignment */
-#define ALIGNMENT 8
+/*   명시적 가용 리스트 매크로   */
+#define PTRSIZE (sizeof(void *))  //  payload 에 저장하는 리스트 포인터 크기 (32비트 4, 64비트 8)
+
+#define PRED(bp) (*(void **)(bp))                        //  가용 블록의 이전 가용 블록 (payload 첫 번째 칸)
+#define SUCC(bp) (*(void **)((char *)(bp) + PTRSIZE))    //  가용 블록의 다음 가용 블록 (payload 두 번째 칸)
+#define FREE_LINKS (4 * PTRSIZE)  //  free 블록이 payload 앞에 쓰는 링크 크기 (리스트는 pred/succ 두 칸, 트리 노드는 네 칸)
+/*   명시적 가용 리스트 매크로   */
 
-/* rounds up to the nearest multiple of ALIGNMENT */
-#define ALIGN(size) (((size) + (ALIGNMENT-1)) & ~0x7)
+/* rounds up to the nearest multiple of ALIGNMENT (8, or 16 with MM_LAYOUT64) */
+#define ALIGN(size) (((size) + (ALIGNMENT-1)) & ~(ALIGNMENT-1))
 
 
 #define SIZE_T_SIZE (ALIGN(sizeof(size_t)))
 
-void *heap_listp;
+//  최소 블록 크기. 할당 블록은 header 뿐이지만 free 가 되었을 때 header + pred + succ + footer 가 들어가야 한다
+#define MIN_BLK_SIZE ALIGN(DSIZE + 2 * PTRSIZE)
+#define ALIGNED_FIT_SCAN 8  //  정렬 할당이 리스트 하나에서 살펴보는 free 블록 수
+#define BATCH_CARVE (16 * CHUNKSIZE)  //  mm_malloc_batch 가 free 블록 하나에서 한 번에 떼어 내는 최대 바이트
+
+/*
+ * 가용 블록 색인 엔진. 빌드할 때 MM_TLSF 를 정의하면 TLSF 엔진을,
+ * 아니면 분리 가용 리스트 엔진을 쓴다. 두 엔진 모두 free_lists[] 의
+ * 이중 연결 리스트와 경계 태그(coalesce)는 공유하고, 크기 => 리스트 번호
+ * 매핑(list_index), 비트맵 갱신(mark_list/unmark_list), find_fit 만 다르다.
+ */
+#ifdef MM_TLSF
+
+/*   TLSF(two-level segregated fit) 설정   */
+#define SL_LOG2 4                            //  1단계 구간 하나를 2^4 = 16개의 2단계 리스트로 나눈다
+#define SL_COUNT (1 << SL_LOG2)
+#define FL_SHIFT (SL_LOG2 + 3)               //  2^7 = 128 미만은 fl = 0 에서 8바이트 단위로 선형 분할
+#define FL_COUNT (8 * WSIZE - FL_SHIFT + 1)  //  header 워드로 담을 수 있는 블록 크기까지 표현 (최대 64 - 7 + 1 = 58)
+#define NUM_LISTS (FL_COUNT * SL_COUNT)
+#define TLSF_ENGINE 1
+
+#else /* !MM_TLSF */
+
+/*   분리 가용 리스트(segregated list) 설정   */
+#define SMALL_LIMIT 128  //  이 크기 이하는 ALIGNMENT 단위로 정확한 크기 클래스를 하나씩 둔다
+#define NUM_SMALL_CLASSES (SMALL_LIMIT / ALIGNMENT)  //  8, 16, ..., 128 => 16개 (16바이트 정렬이면 8개)
+#define NUM_LISTS (NUM_SMALL_CLASSES + 25)  //  (128,256], (256,512], ... 2의 거듭제곱 클래스, 마지막은 나머지 전부
+#define TREE_LIMIT 2048  //  이보다 큰 free 블록은 리스트 대신 크기 순 트리에 넣는다 (그 위의 클래스는 비어 있다)
+#define TLSF_ENGINE 0
+
+/*   큰 free 블록의 red-black 트리 노드. payload 앞 네 칸 (pred/succ 자리를 같이 쓴다)   */
+#define T_LEFT(bp) (*(void **)(bp))
+#define T_RIGHT(bp) (*(void **)((char *)(bp) + PTRSIZE))
+#define T_PARENT(bp) (*(void **)((char *)(bp) + 2 * PTRSIZE))
+#define T_RED(bp) (*(size_t *)((char *)(bp) + 3 * PTRSIZE))
+#define IS_RED(bp) ((bp) != NULL && T_RED(bp))  //  빈 자리(NULL)는 검은색
+
+#endif /* MM_TLSF */
+
+/*   슬랩 설정   */
+#define SLAB_MAX 64              //  이 크기 이하의 요청은 슬랩에서 할당
+#define SLAB_NUM_CLASSES (SLAB_MAX / ALIGNMENT)
+#define SLAB_RUN_SIZE (1 << 12)  //  run 하나의 크기 = 페이지 크기 (주소 정렬 단위이기도 함)
+#define SLAB_MAP_WORDS 8         //  run 하나의 오브젝트 수 상한 = 8 * 64 = 512
+
+typedef struct slab_run {
+    struct slab_run *prev;       //  같은 클래스 partial 리스트의 이전/다음 run
+    struct slab_run *next;
+    unsigned short cls;          //  크기 클래스
+    unsigned short nobjs;        //  run 이 담는 오브젝트 수
+    unsigned short nfree;        //  비어있는 오브젝트 수
+    unsigned short first;        //  run 앞에서 첫 오브젝트까지의 거리
+    unsigned long long used[SLAB_MAP_WORDS];  //  오브젝트별 사용 비트 (1 = 사용 중)
+} slab_run_t;
+
+#define SLAB_HDR_SIZE ALIGN(sizeof(slab_run_t))  //  run 앞에서 첫 오브젝트까지. 오브젝트도 ALIGNMENT 에 맞춘다
+
+#define RUN_MAP_SIZE(limit) ((limit) / SLAB_RUN_SIZE / 8 + 1)  //  limit 바이트 영역의 run_map 크기
+
+/*   스레드 캐시 설정   */
+#define TCACHE_MAX 512      //  이 크기 이하의 요청은 스레드 캐시를 먼저 본다
+#define TCACHE_DEPTH 16     //  bin 하나에 캐시해 두는 블록 수 상한
+#define TCACHE_MIN_BLK ALIGN(SLAB_MAX + 1 + WSIZE)  //  슬랩보다 큰 요청의 가장 작은 블록 크기
+#define TCACHE_MAX_BLK ALIGN(TCACHE_MAX + WSIZE)
+#define TCACHE_BINS (SLAB_NUM_CLASSES + (TCACHE_MAX_BLK - TCACHE_MIN_BLK) / ALIGNMENT + 1)  //  슬랩 클래스 + 힙 블록 크기별
+
+#define TCACHE_NEXT(bp) (*(void **)(bp))  //  캐시된 블록의 payload 첫 칸에 다음 블록을 저장
+
+//  quick list: 아레나별로 병합을 미룬 힙 블록 (스레드 캐시에서 넘친 블록도 여기로 온다)
+//  TLSF 빌드에서는 쓰지 않는다: 연산 하나의 시간이 일정해야 하는데, 미뤄 둔 병합은 free 한 번에 몰아서 일어난다
+#define QUICK_MAX_BLK 1024                      //  이 크기 이하의 힙 블록은 free 해도 바로 병합하지 않는다
+#define QUICK_BINS (QUICK_MAX_BLK / ALIGNMENT)  //  블록 크기별(ALIGNMENT 단위) 정확한 bin
+#define QUICK_BUDGET (32 * 1024)                //  quick list 에 쌓아 둘 수 있는 바이트. 넘으면 한꺼번에 병합
+#define QUICK_NEXT(bp) (*(void **)(bp))         //  payload 첫 칸에 다음 블록을 저장
+
+typedef struct {
+    unsigned int epoch;                   //  이 캐시가 속한 힙 세대 (heap_epoch 와 다르면 무효)
+    int registered;                       //  스레드 종료 시 반납하도록 pthread 키에 등록했는지
+    unsigned char count[TCACHE_BINS];     //  bin 별 블록 수
+    void *head[TCACHE_BINS];              //  bin 별 블록 스택
+    size_t frees, hits;                   //  통계: 캐시에 둔 힙 블록 free 와, 그것을 다시 준 malloc (슬랩 제외)
+} tcache_t;
+
+/*
+ * 아레나(arena) - 자기만의 brk 영역(mem_region)과 가용 리스트, 슬랩을 가진
+ * 독립된 힙 하나. 스레드는 처음 할당할 때 라운드 로빈으로 아레나 하나를
+ * 배정받아 계속 그 아레나에서 할당하고, free 는 주소가 속한 아레나로 돌아간다.
+ * 아레나마다 락이 따로 있어서 다른 아레나를 쓰는 스레드끼리는 경쟁하지 않는다.
+ *
+ * 다른 아레나의 스레드가 free 한 블록은 그 아레나의 락을 잡지 않고 remote_free
+ * 스택에 CAS 로 넣기만 한다(여러 생산자, 소비자 하나). 아레나 락을 잡는 쪽이
+ * 다음 malloc/free 때 스택을 통째로 떼어 와서 한꺼번에 힙에 돌려준다.
+ */
+#define MAX_ARENAS 8
+
+typedef struct arena {
+    pthread_mutex_t lock;               //  이 아레나의 가용 리스트, 슬랩, brk 영역을 보호
+    mem_region_t *region;               //  이 아레나의 brk 영역
+    size_t limit;                       //  영역이 자랄 수 있는 크기
+    void *remote_free;                  //  다른 아레나 스레드가 free 한 블록 스택 (TCACHE_NEXT 로 연결)
+    char *heap_listp;                   //  prologue 블록의 payload
+    void *free_lists[NUM_LISTS];        //  리스트별 가용 블록의 첫 번째 블록 (비어 있으면 NULL)
+    void *rover[NUM_LISTS];             //  next-fit: 리스트별로 다음 탐색을 시작할 블록 (NULL 이면 맨 앞)
+#ifdef MM_TLSF
+    unsigned long long fl_bitmap;       //  fl 번째 비트 = sl_bitmap[fl] 이 0 이 아님
+    unsigned int sl_bitmap[FL_COUNT];   //  sl 번째 비트 = free_lists[fl * SL_COUNT + sl] 이 비어있지 않음
+#else
+    unsigned long long seg_bitmap;      //  i 번째 비트 = free_lists[i] 가 비어있지 않음
+    void *tree_root;                    //  TREE_LIMIT 보다 큰 free 블록의 트리 (크기, 주소 순)
+#endif
+    slab_run_t *slab_partial[SLAB_NUM_CLASSES];  //  클래스별 빈 칸이 있는 run 리스트
+    unsigned char *run_map;                      //  영역 페이지별 1비트: 슬랩 run 인지 (RUN_MAP_SIZE(limit) 바이트)
+    size_t run_map_used;                         //  run_map 에서 비트를 켠 적이 있는 앞쪽 바이트 수
+    char *zero_from;                    //  여기부터 brk 까지는 영역을 늘린 뒤 할당된 적이 없어 0 (마지막 free 블록의 footer 와 epilogue 만 예외)
+    void *quick[QUICK_BINS];            //  블록 크기별 병합을 미룬 블록 스택. 힙에서는 할당 상태 그대로다
+    size_t quick_bytes;                 //  quick list 에 있는 블록 크기의 합
+    size_t quick_frees, quick_hits;     //  통계: quick list 에 넣은 free 수, quick list 에서 바로 준 malloc 수
+    size_t quick_runs, quick_merged;    //  통계: 한꺼번에 병합한 횟수와 그때 병합한 블록 수
+} arena_t;
+
+static arena_t arenas[MAX_ARENAS];
+static int num_arenas;                   //  만들어진 아레나 수 (arenas[0] 은 mem_init 의 기본 영역)
+static int max_arenas;                   //  아레나 수 상한 (CPU 수, 최대 MAX_ARENAS)
+static int next_arena;                   //  라운드 로빈 배정용 카운터
+static pthread_mutex_t arenas_lock = PTHREAD_MUTEX_INITIALIZER;  //  아레나 생성과 mm_init 을 보호
+static __thread arena_t *thread_arena;   //  이 스레드에 배정된 아레나
+static unsigned int heap_epoch;          //  mm_init 마다 1씩 증가
+static __thread tcache_t tcache;         //  스레드별 캐시
+static pthread_key_t tcache_key;         //  스레드 종료 시 tcache_destroy 호출용
+static pthread_once_t tcache_once = PTHREAD_ONCE_INIT;
+static size_t tcache_frees, tcache_hits;  //  통계: 끝난 스레드들의 캐시 frees/hits 합
+
+/*
+ * 배치 정책 - find_fit 이 가용 리스트 하나를 훑을 때 어떤 블록을 고를지 정한다.
+ *     first : 처음 맞는 블록 (기본)
+ *     next  : 리스트마다 지난번에 고른 자리(rover)부터 이어서 first-fit
+ *     best  : 리스트 전체에서 가장 작은 맞는 블록 (크기가 딱 맞으면 바로 멈춘다)
+ *     good  : 처음 맞는 GOOD_FIT_K 개 중 가장 작은 블록
+ * mm_set_policy 로 바꾸거나, 그 전에 첫 mm_init 이 환경 변수 MM_POLICY 를 읽는다.
+ */
+#ifndef GOOD_FIT_K
+#define GOOD_FIT_K 4
+#endif
+
+static int fit_policy = -1;  //  mm_policy_t. 아직 정하지 않았으면 -1
+static const char *policy_names[MM_NUM_POLICIES] = {"first", "next", "best", "good"};
+
+//  리스트 idx 에서 정책대로 asize 이상인 블록을 고른다 (없으면 NULL)
+static void *scan_list(arena_t *ar, int idx, size_t asize)
+{
+    void *bp, *start, *best = NULL;
+    size_t size, best_size = 0;
+    int seen = 0;
+
+    if (ar->free_lists[idx] == NULL)
+        return NULL;
+
+    switch (fit_policy) {
+    case MM_NEXT_FIT:
+        //  rover 부터 끝까지, 그다음 맨 앞부터 rover 앞까지. 고른 블록은 빠지면서 rover 를 다음으로 넘긴다
+        start = bp = ar->rover[idx] != NULL ? ar->rover[idx] : ar->free_lists[idx];
+        do {
+            if (GET_SIZE(HDRP(bp)) >= asize) {
+                ar->rover[idx] = bp;
+                return bp;
+            }
+            bp = SUCC(bp) != NULL ? SUCC(bp) : ar->free_lists[idx];
+        } while (bp != start);
+        return NULL;
+
+    case MM_BEST_FIT:
+    case MM_GOOD_FIT:
+        for (bp = ar->free_lists[idx]; bp != NULL; bp = SUCC(bp)) {
+            if ((size = GET_SIZE(HDRP(bp))) < asize)
+                continue;
+            if (best == NULL || size < best_size) {
+                best = bp;
+                best_size = size;
+            }
+            if (size == asize || (fit_policy == MM_GOOD_FIT && ++seen == GOOD_FIT_K))
+                break;
+        }
+        return best;
+
+    default:
+        for (bp = ar->free_lists[idx]; bp != NULL; bp = SUCC(bp)) {
+            if (GET_SIZE(HDRP(bp)) >= asize)
+                return bp;
+        }
+        return NULL;
+    }
+}
+
+#ifdef MM_TLSF
+
+//  블록 크기 size 를 (fl, sl) 로 나눈다
+static void tlsf_mapping(size_t size, int *fl, int *sl)
+{
+    int msb;
+
+    if (size < (1 << FL_SHIFT))
+    {
+        *fl = 0;
+        *sl = (int)(size >> 3);  //  작은 블록은 8바이트 간격으로 정확히 나눈다
+        return;
+    }
+    msb = 63 - __builtin_clzll((unsigned long long)size);  //  최상위 비트 위치 = 1단계
+    *sl = (int)(size >> (msb - SL_LOG2)) ^ SL_COUNT;      //  그 아래 SL_LOG2 비트 = 2단계
+    *fl = msb - FL_SHIFT + 1;
+}
+
+//  가용 블록 크기 size 가 들어갈 리스트 번호
+static int list_index(size_t size)
+{
+    int fl, sl;
+
+    tlsf_mapping(size, &fl, &sl);
+    return fl * SL_COUNT + sl;
+}
+
+static void mark_list(arena_t *ar, int idx)
+{
+    ar->sl_bitmap[idx / SL_COUNT] |= 1U << (idx % SL_COUNT);
+    ar->fl_bitmap |= 1ULL << (idx / SL_COUNT);
+}
+
+static void unmark_list(arena_t *ar, int idx)
+{
+    ar->sl_bitmap[idx / SL_COUNT] &= ~(1U << (idx % SL_COUNT));
+    if (ar->sl_bitmap[idx / SL_COUNT] == 0)
+        ar->fl_bitmap &= ~(1ULL << (idx / SL_COUNT));
+}
+
+static void reset_lists(arena_t *ar)
+{
+    memset(ar->free_lists, 0, sizeof(ar->free_lists));
+    memset(ar->rover, 0, sizeof(ar->rover));
+    memset(ar->sl_bitmap, 0, sizeof(ar->sl_bitmap));
+    ar->fl_bitmap = 0;
+}
+
+// 비트맵 두 단계만 보고 asize 이상이 보장되는 리스트의 맨 앞 블록을 O(1)에 찾는다.
+// first-fit 이 아니면 asize 가 매핑되는 리스트부터 정책대로 훑고, 찾은 리스트 안에서도 정책대로 고른다
+static void *find_fit(arena_t *ar, size_t asize)
+{
+    int fl, sl;
+    unsigned long long bits;
+    size_t rsize;
+    void *bp;
+
+    //  asize 보다 작은 블록도 섞인 리스트라서 O(1) 이 아니게 된다
+    if (fit_policy > MM_FIRST_FIT) {
+        tlsf_mapping(asize, &fl, &sl);
+        if (fl < FL_COUNT && (bp = scan_list(ar, fl * SL_COUNT + sl, asize)) != NULL)
+            return bp;
+    }
+
+    //  asize 를 다음 2단계 경계로 올려서 매핑 => 찾은 리스트의 모든 블록이 asize 이상
+    rsize = asize;
+    if (rsize >= (1 << FL_SHIFT))
+        rsize += (1ULL << (63 - __builtin_clzll((unsigned long long)rsize) - SL_LOG2)) - 1;
+    tlsf_mapping(rsize, &fl, &sl);
+    if (fl >= FL_COUNT)
+        return NULL;
+
+    //  같은 1단계 안에서 sl 이상인 2단계 리스트
+    bits = ar->sl_bitmap[fl] & (~0U << sl);
+    if (bits == 0)
+    {
+        //  없으면 더 큰 1단계 중 비어있지 않은 첫 번째
+        bits = (fl + 1 < 64) ? ar->fl_bitmap & (~0ULL << (fl + 1)) : 0;
+        if (bits == 0)
+            return NULL;  // 맞는 블록이 없음 => 힙 확장 필요
+        fl = __builtin_ctzll(bits);
+        bits = ar->sl_bitmap[fl];
+    }
+    sl = __builtin_ctzll(bits);
+    return scan_list(ar, fl * SL_COUNT + sl, asize);  //  모두 asize 이상이라 first-fit 은 맨 앞 블록
+}
+
+#else /* !MM_TLSF */
+
+//  블록 크기 asize 가 속하는 크기 클래스 번호. 분기 몇 번과 clz 한 번으로 끝난다
+static int list_index(size_t asize)
+{
+    int cls;
+
+    if (asize <= SMALL_LIMIT)
+        return (int)(asize / ALIGNMENT) - 1;  //  작은 크기는 정확한 크기 클래스
+
+    //  (2^k, 2^(k+1)] 구간을 하나의 클래스로 묶는다. 128 초과의 첫 구간이 k = 7
+    cls = NUM_SMALL_CLASSES + (63 - __builtin_clzll((unsigned long long)(asize - 1))) - 7;
+    return cls < NUM_LISTS ? cls : NUM_LISTS - 1;
+}
+
+static void mark_list(arena_t *ar, int idx)
+{
+    ar->seg_bitmap |= 1ULL << idx;
+}
+
+static void unmark_list(arena_t *ar, int idx)
+{
+    ar->seg_bitmap &= ~(1ULL << idx);
+}
+
+static void reset_lists(arena_t *ar)
+{
+    memset(ar->free_lists, 0, sizeof(ar->free_lists));
+    memset(ar->rover, 0, sizeof(ar->rover));
+    ar->seg_bitmap = 0;
+    ar->tree_root = NULL;
+}
+
+/*
+ * 큰 free 블록의 트리 - 크기로, 크기가 같으면 주소로 정렬한 red-black 트리.
+ * 노드는 free 블록의 payload 안에 있으므로 따로 메모리가 필요 없다.
+ * 2의 거듭제곱 클래스 하나에 크기가 두 배까지 차이 나는 블록이 섞이는 대신,
+ * asize 이상인 가장 작은 블록(같으면 가장 낮은 주소)을 O(log n) 에 찾는다.
+ */
+static int tree_less(void *a, void *b)
+{
+    size_t sa = GET_SIZE(HDRP(a)), sb = GET_SIZE(HDRP(b));
+
+    return sa < sb || (sa == sb && (char *)a < (char *)b);
+}
+
+//  u 자리에 v 를 단다 (v 는 NULL 이어도 된다)
+static void tree_replace(arena_t *ar, void *u, void *v)
+{
+    void *p = T_PARENT(u);
+
+    if (p == NULL)
+        ar->tree_root = v;
+    else if (T_LEFT(p) == u)
+        T_LEFT(p) = v;
+    else
+        T_RIGHT(p) = v;
+    if (v != NULL)
+        T_PARENT(v) = p;
+}
+
+static void tree_rotate_left(arena_t *ar, void *x)
+{
+    void *y = T_RIGHT(x);
+
+    T_RIGHT(x) = T_LEFT(y);
+    if (T_LEFT(y) != NULL)
+        T_PARENT(T_LEFT(y)) = x;
+    tree_replace(ar, x, y);
+    T_LEFT(y) = x;
+    T_PARENT(x) = y;
+}
+
+static void tree_rotate_right(arena_t *ar, void *x)
+{
+    void *y = T_LEFT(x);
+
+    T_LEFT(x) = T_RIGHT(y);
+    if (T_RIGHT(y) != NULL)
+        T_PARENT(T_RIGHT(y)) = x;
+    tree_replace(ar, x, y);
+    T_RIGHT(y) = x;
+    T_PARENT(x) = y;
+}
+
+//  free 블록 bp 를 트리에 넣고 red-black 규칙을 맞춘다
+static void tree_insert(arena_t *ar, void *bp)
+{
+    void **link = &ar->tree_root;
+    void *p = NULL, *g, *u;
+
+    while (*link != NULL) {
+        p = *link;
+        link = tree_less(bp, p) ? &T_LEFT(p) : &T_RIGHT(p);
+    }
+    T_LEFT(bp) = T_RIGHT(bp) = NULL;
+    T_PARENT(bp) = p;
+    T_RED(bp) = 1;
+    *link = bp;
+
+    //  빨강 부모 아래의 빨강 bp 를 고친다. 삼촌이 빨강이면 색만 바꿔 위로, 아니면 회전
+    while ((p = T_PARENT(bp)) != NULL && T_RED(p)) {
+        g = T_PARENT(p);
+        if (p == T_LEFT(g)) {
+            u = T_RIGHT(g);
+            if (IS_RED(u)) {
+                T_RED(p) = T_RED(u) = 0;
+                T_RED(g) = 1;
+                bp = g;
+                continue;
+            }
+            if (bp == T_RIGHT(p)) {
+                tree_rotate_left(ar, p);
+                bp = p;
+                p = T_PARENT(bp);
+            }
+            T_RED(p) = 0;
+            T_RED(g) = 1;
+            tree_rotate_right(ar, g);
+        } else {
+            u = T_LEFT(g);
+            if (IS_RED(u)) {
+                T_RED(p) = T_RED(u) = 0;
+                T_RED(g) = 1;
+                bp = g;
+                continue;
+            }
+            if (bp == T_LEFT(p)) {
+                tree_rotate_right(ar, p);
+                bp = p;
+                p = T_PARENT(bp);
+            }
+            T_RED(p) = 0;
+            T_RED(g) = 1;
+            tree_rotate_left(ar, g);
+        }
+    }
+    T_RED(ar->tree_root) = 0;
+}
+
+//  bp 를 트리에서 뺀다. 검은 노드가 빠져서 x 쪽(부모 xp)의 검은 높이가 하나 모자라면 고친다
+static void tree_remove(arena_t *ar, void *bp)
+{
+    void *y, *x, *xp, *w;
+    int removed_red = T_RED(bp);
+
+    if (T_LEFT(bp) == NULL || T_RIGHT(bp) == NULL) {
+        x = T_LEFT(bp) != NULL ? T_LEFT(bp) : T_RIGHT(bp);
+        xp = T_PARENT(bp);
+        tree_replace(ar, bp, x);
+    } else {
+        //  자식이 둘이면 오른쪽의 가장 작은 노드 y 를 bp 자리로 올린다
+        for (y = T_RIGHT(bp); T_LEFT(y) != NULL; y = T_LEFT(y))
+            ;
+        removed_red = T_RED(y);
+        x = T_RIGHT(y);
+        if (T_PARENT(y) == bp) {
+            xp = y;
+        } else {
+            xp = T_PARENT(y);
+            tree_replace(ar, y, x);
+            T_RIGHT(y) = T_RIGHT(bp);
+            T_PARENT(T_RIGHT(y)) = y;
+        }
+        tree_replace(ar, bp, y);
+        T_LEFT(y) = T_LEFT(bp);
+        T_PARENT(T_LEFT(y)) = y;
+        T_RED(y) = T_RED(bp);
+    }
+    if (removed_red)
+        return;
+
+    while (x != ar->tree_root && !IS_RED(x)) {
+        if (x == T_LEFT(xp)) {
+            w = T_RIGHT(xp);
+            if (T_RED(w)) {
+                T_RED(w) = 0;
+                T_RED(xp) = 1;
+                tree_rotate_left(ar, xp);
+                w = T_RIGHT(xp);
+            }
+            if (!IS_RED(T_LEFT(w)) && !IS_RED(T_RIGHT(w))) {
+                T_RED(w) = 1;
+                x = xp;
+                xp = T_PARENT(x);
+                continue;
+            }
+            if (!IS_RED(T_RIGHT(w))) {
+                T_RED(T_LEFT(w)) = 0;
+                T_RED(w) = 1;
+                tree_rotate_right(ar, w);
+                w = T_RIGHT(xp);
+            }
+            T_RED(w) = T_RED(xp);
+            T_RED(xp) = 0;
+            T_RED(T_RIGHT(w)) = 0;
+            tree_rotate_left(ar, xp);
+        } else {
+            w = T_LEFT(xp);
+            if (T_RED(w)) {
+                T_RED(w) = 0;
+                T_RED(xp) = 1;
+                tree_rotate_right(ar, xp);
+                w = T_LEFT(xp);
+            }
+            if (!IS_RED(T_LEFT(w)) && !IS_RED(T_RIGHT(w))) {
+                T_RED(w) = 1;
+                x = xp;
+                xp = T_PARENT(x);
+                continue;
+            }
+            if (!IS_RED(T_LEFT(w))) {
+                T_RED(T_RIGHT(w)) = 0;
+                T_RED(w) = 1;
+                tree_rotate_left(ar, w);
+                w = T_LEFT(xp);
+            }
+            T_RED(w) = T_RED(xp);
+            T_RED(xp) = 0;
+            T_RED(T_LEFT(w)) = 0;
+            tree_rotate_right(ar, xp);
+        }
+        x = ar->tree_root;
+    }
+    if (x != NULL)
+        T_RED(x) = 0;
+}
+
+//  asize 이상인 가장 작은 블록. 크기가 같으면 주소가 가장 낮은 블록 (없으면 NULL)
+static void *tree_best_fit(arena_t *ar, size_t asize)
+{
+    void *bp = ar->tree_root, *best = NULL;
+
+    while (bp != NULL) {
+        if (GET_SIZE(HDRP(bp)) >= asize) {
+            best = bp;
+            bp = T_LEFT(bp);
+        } else {
+            bp = T_RIGHT(bp);
+        }
+    }
+    return best;
+}
+
+//  트리에서 bp 다음 순서의 블록
+static void *tree_next(void *bp)
+{
+    void *p;
+
+    if (T_RIGHT(bp) != NULL) {
+        for (bp = T_RIGHT(bp); T_LEFT(bp) != NULL; bp = T_LEFT(bp))
+            ;
+        return bp;
+    }
+    while ((p = T_PARENT(bp)) != NULL && T_RIGHT(p) == bp)
+        bp = p;
+    return p;
+}
+
+// 분리 가용 리스트에서 적절한 free block을 찾는 함수. 리스트 안에서는 배치 정책대로 고르고,
+// 큰 블록은 정책과 상관없이 트리에서 best-fit (트리의 첫 후보가 곧 가장 작은 블록이다)
+static void *find_fit(arena_t *ar, size_t asize)
+{
+    int cls;
+    unsigned long long bits;
+    void *bp;
+
+    if (asize > TREE_LIMIT)
+        return tree_best_fit(ar, asize);
+    cls = list_index(asize);
+
+    // 1. asize 가 속한 클래스: 2의 거듭제곱 클래스는 asize 보다 작은 블록도 섞여 있다
+    if ((bp = scan_list(ar, cls, asize)) != NULL)
+    {
+        return bp;
+    }
+
+    // 2. 더 큰 클래스의 블록은 모두 asize 이상이므로, 비어있지 않은 첫 클래스에서 고른다 (first-fit 은 맨 앞 블록)
+    bits = (cls + 1 < NUM_LISTS) ? ar->seg_bitmap & (~0ULL << (cls + 1)) : 0;
+    if (bits == 0)
+    {
+        return tree_best_fit(ar, asize);  // 리스트에 없으면 트리의 가장 작은 블록. 그것도 없으면 힙 확장 필요
+    }
+    return scan_list(ar, __builtin_ctzll(bits), asize);
+}
+
+#endif /* MM_TLSF */
+
+//  end 앞까지는 블록 내용이 쓰였을 수 있다고 기록한다. zero_from 은 할당으로 올라가고 trim 으로만 내려간다
+static void touch_heap(arena_t *ar, char *end)
+{
+    if (end > ar->zero_from)
+        ar->zero_from = end;
+}
+
+//  가용 블록 bp 를 자기 크기의 리스트 맨 앞에 넣는다 (LIFO). 큰 블록은 트리에 넣는다
+static void insert_free_block(arena_t *ar, void *bp)
+{
+    int idx;
+
+#ifndef MM_TLSF
+    if (GET_SIZE(HDRP(bp)) > TREE_LIMIT) {
+        tree_insert(ar, bp);
+        return;
+    }
+#endif
+    idx = list_index(GET_SIZE(HDRP(bp)));
+
+    PRED(bp) = NULL;
+    SUCC(bp) = ar->free_lists[idx];
+    if (ar->free_lists[idx] != NULL)
+        PRED(ar->free_lists[idx]) = bp;
+    ar->free_lists[idx] = bp;
+    mark_list(ar, idx);
+}
+
+//  가용 블록 bp 를 리스트에서 뺀다. bp 의 header 는 아직 넣을 때의 크기여야 한다
+static void remove_free_block(arena_t *ar, void *bp)
+{
+    int idx;
+
+#ifndef MM_TLSF
+    if (GET_SIZE(HDRP(bp)) > TREE_LIMIT) {
+        tree_remove(ar, bp);
+        return;
+    }
+#endif
+    idx = list_index(GET_SIZE(HDRP(bp)));
+
+    if (PRED(bp) != NULL)
+        SUCC(PRED(bp)) = SUCC(bp);
+    else
+    {
+        ar->free_lists[idx] = SUCC(bp);
+        if (ar->free_lists[idx] == NULL)
+            unmark_list(ar, idx);  //  리스트가 비었으면 비트맵에서도 지운다
+    }
+
+    if (SUCC(bp) != NULL)
+        PRED(SUCC(bp)) = PRED(bp);
+    if (ar->rover[idx] == bp)
+        ar->rover[idx] = SUCC(bp);  //  next-fit 은 빠진 블록 다음부터 이어서 찾는다
+}
 
-static void *coalesce(void *bp)
+static void *coalesce(arena_t *ar, void *bp)
 {
-    size_t prev_alloc = GET_ALLOC(FTRP(PREV_BLKP(bp)));  //  이전 블록 할당 여부
+    size_t prev_alloc = GET_PREV_ALLOC(HDRP(bp));        //  이전 블록 할당 여부 (이전 블록 footer 대신 내 header 의 비트)
     size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));  //  다음 블록 할당 여부
     size_t size = GET_SIZE(HDRP(bp));  //  전체 블록 크기
 
     //  case 1 : 이전/다음 모두 할당 된 경우 => 병합 불가
     if (prev_alloc && next_alloc)
     {
-        return bp;
     }
 
     // case 2 : 다음 블록만 free => 다음 블록과 병합
     else if (prev_alloc && !next_alloc)
     {
+        remove_free_block(ar, NEXT_BLKP(bp));       //  병합될 다음 블록은 리스트에서 제거
         size += GET_SIZE(HDRP(NEXT_BLKP(bp)));  //  크기 확장
-        PUT(HDRP(bp), PACK(size, 0));           //  header 갱신
-        PUT(FTRP(bp), PACK(size, 0));           //  footer 갱신
-        return bp;
+        PUT(HDRP(bp), PACK(size, 0) | PREV_ALLOC);  //  header 갱신
+        PUT(FTRP(bp), PACK(size, 0));               //  footer 갱신
     }
 
-    // case 3 : 이전 블록만 free => 이전 블록과 병합
+    // case 3 : 이전 블록만 free => 이전 블록과 병합 (이전 블록이 free 라서 footer 를 읽을 수 있다)
     else if (!prev_alloc && next_alloc)
     {
+        remove_free_block(ar, PREV_BLKP(bp));           //  병합될 이전 블록은 리스트에서 제거
         size += GET_SIZE(HDRP(PREV_BLKP(bp)));      //  크기 확장
         PUT(FTRP(bp), PACK(size, 0));               //  footer 갱신 (현재 블록 기준)
-        PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0));    //  이전 블록의 header 갱신
+        PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0) | PREV_ALLOC);  //  이전 블록의 header 갱신 (free 끼리는 붙어있지 않으므로 그 앞은 할당)
         bp = PREV_BLKP(bp);         //  병합 후 위치 이동
     }
 
     // case 4 : 이전/다음 모두 free => 세 개 병합
     else
     {
+        remove_free_block(ar, PREV_BLKP(bp));   //  이전/다음 블록 모두 리스트에서 제거
+        remove_free_block(ar, NEXT_BLKP(bp));
         size += GET_SIZE(HDRP(PREV_BLKP(bp))) + GET_SIZE(FTRP(NEXT_BLKP(bp)));  // 크기 확장 (이전 + 다음 블록과 병합
-        PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0));    //  header : 이전 블록 기준
-        PUT(FTRP(NEXT_BLKP(bp)), PACK(size, 0));    //  footer : 다음 블록 기준
+        PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0) | PREV_ALLOC);  //  header : 이전 블록 기준
+        PUT(FTRP(NEXT_BLKP(bp)), PACK(size, 0));               //  footer : 다음 블록 기준
         bp = PREV_BLKP(bp);             //  병합된 블록의 시작 위치로 이동
     }
+
+    CLR_PREV_ALLOC(HDRP(NEXT_BLKP(bp)));  //  뒤 블록에게 앞 블록이 free 가 되었음을 알린다
+    insert_free_block(ar, bp);  //  병합이 끝난 블록 하나만 리스트 맨 앞에 넣는다
     return bp;
 }
 
 
-static void *extend_heap(size_t words)
+static void *extend_heap(arena_t *ar, size_t words)
 {
-    char *bp;
+    char *bp, *merged;
     size_t size;
 
     size = (words % 2) ? (words + 1) * WSIZE : words * WSIZE;
-    if ((long)(bp = mem_sbrk(size)) == -1)
+    if (size > INT_MAX)  //  mem_sbrk 는 int 만큼만 늘릴 수 있다
+        return NULL;
+    if ((long)(bp = mem_region_sbrk(ar->region, size)) == -1)
         return NULL;
 
-    PUT(HDRP(bp), PACK(size, 0));
+    //  새 블록의 header 는 이전 epilogue 자리이므로 앞 블록 할당 비트를 그대로 물려받는다
+    PUT(HDRP(bp), PACK(size, 0) | GET_PREV_ALLOC(HDRP(bp)));
     PUT(FTRP(bp), PACK(size, 0));
     PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1));
-    return coalesce(bp);
+    if ((merged = coalesce(ar, bp)) != bp && HDRP(bp) - WSIZE >= merged + FREE_LINKS) {
+        //  앞 free 블록과 합쳐졌으면 그 footer 와 이전 epilogue 는 이제 블록 안쪽이다. 새 영역처럼 0 으로 둔다.
+        //  앞 블록이 작아서 그 자리가 링크 안쪽이면 zero_from 아래이므로 그대로 둔다
+        PUT(HDRP(bp) - WSIZE, 0);
+        PUT(HDRP(bp), 0);
+    }
+    touch_heap(ar, merged + FREE_LINKS);  //  링크는 zero_from 아래에 둔다
+    return merged;
 }
 
-/* 
- * mm_init - initialize the malloc package.
- */
-int mm_init(void)
+// 빈 힙(prologue + epilogue + 첫 free 블록)을 만든다
+static int heap_init(arena_t *ar)
 {
-    //  1. 힙을 위한 최소 공간 16바이트 확보 (padding + prologue header/footer + epilogue header)
-    heap_listp = mem_sbrk(4 * WSIZE);
-    if (heap_listp == (void *)-1) {
+    //  1. 힙을 위한 최소 공간 4워드 확보 (padding + prologue header/footer + epilogue header)
+    ar->heap_listp = mem_region_sbrk(ar->region, 4 * WSIZE);
+    if (ar->heap_listp == (void *)-1) {
         return -1;  //  sbrk 실패 시 에러 리턴
     }
     //  2. 초기 블록들 구성하는 단계
-    PUT(heap_listp, 0);                                 //  Alignment padding
-    PUT(heap_listp + (1 * WSIZE), PACK(DSIZE, 1));      //  Prologue header (8바이트, 할당됨)
-    PUT(heap_listp + (2 * WSIZE), PACK(DSIZE, 1));      //  Prologue footer
-    PUT(heap_listp + (3 * WSIZE), PACK(0, 1));          //  Epilogue header (0바이트, 할당됨)
+    PUT(ar->heap_listp, 0);                                 //  Alignment padding
+    PUT(ar->heap_listp + (1 * WSIZE), PACK(DSIZE, 1));      //  Prologue header (DSIZE 바이트, 할당됨)
+    PUT(ar->heap_listp + (2 * WSIZE), PACK(DSIZE, 1));      //  Prologue footer
+    PUT(ar->heap_listp + (3 * WSIZE), PACK(0, 1) | PREV_ALLOC);  //  Epilogue header (0바이트, 할당됨, 앞은 prologue)
 
     //  3. payload 기준 위치로 이동 (Prologue 블록의 payload 포인터)
-    heap_listp += (2 * WSIZE);
+    ar->heap_listp += (2 * WSIZE);
+    reset_lists(ar);  //  모든 가용 리스트와 비트맵은 비어있는 상태에서 시작
+    memset(ar->slab_partial, 0, sizeof(ar->slab_partial));
+    memset(ar->quick, 0, sizeof(ar->quick));
+    ar->quick_bytes = ar->quick_frees = ar->quick_hits = ar->quick_runs = ar->quick_merged = 0;
+    ar->zero_from = (char *)mem_region_hi(ar->region) + 1;  //  비운 영역의 페이지는 돌려받았으므로 brk 위는 0
 
     //  4. 살제 usable한 free block 확보
-    if (extend_heap(CHUNKSIZE/WSIZE) == NULL)
+    if (extend_heap(ar, CHUNKSIZE/WSIZE) == NULL)
         return -1;
     return 0;
 }
 
-/* 
- * mm_malloc - Allocate a block by incrementing the brk pointer.
- *     Always allocate a block whose size is a multiple of the alignment.
- */
+// 요청 크기 size 를 실제 블록 크기로 변환. header 를 붙여 정렬하다 넘치는 크기면 0
+static size_t adjust_size(size_t size)
+{
+    if (size > (size_t)-1 - WSIZE - (ALIGNMENT - 1))
+        return 0;
+    //  할당 블록은 header 만 붙이고 정렬한 뒤, free 가 되었을 때 리스트 포인터와 footer 가 들어갈 만큼은 확보
+    return MAX(ALIGN(size + WSIZE), MIN_BLK_SIZE);
+}
 
-// 적절한 free block을 찾는 first-fit 함수
-static void *find_fit(size_t asize)
+// 주어진 위치에 메모리를 배치 (필요 시 분할)
+static void place(arena_t *ar, void *bp, size_t asize)
 {
-    void *bp = heap_listp;
+    size_t block_size = GET_SIZE(HDRP(bp));  // 현재 블록 전체 크기
+
+    remove_free_block(ar, bp);  // 할당될 블록은 가용 리스트에서 제거
 
-    // 현재 블록이 할당중이거나, 크기가 부족하면 계속 탐색
-    while (GET_ALLOC(HDRP(bp)) || GET_SIZE(HDRP(bp)) < asize)
+    // 남는 공간이 최소 블록 이상일 경우에만 새로운 free 블록으로 분할
+    if (block_size - asize >= MIN_BLK_SIZE)
     {
-        // epilogue 까지 도달한 경우, 더 이상 블록 없음
-        if (GET_SIZE(HDRP(bp)) == 0)
-        {
-            return NULL;
-        }
-        bp = NEXT_BLKP(bp);  // 다음 블록으로 이동 (curr = curr->next 이거랑 비슷한느낌)
-    }
+        PUT(HDRP(bp), PACK(asize, 1) | PREV_ALLOC);  // free 블록의 앞은 항상 할당 상태
 
-    return bp;  // 적절한 free 블록을 찾으면 bp 리턴
+        // 다음 블록의 header/footer를 free 상태로 초기화하고 리스트에 넣는다
+        bp = NEXT_BLKP(bp);
+        PUT(HDRP(bp), PACK(block_size - asize, 0) | PREV_ALLOC);
+        PUT(FTRP(bp), PACK(block_size - asize, 0));
+        insert_free_block(ar, bp);
+        touch_heap(ar, (char *)bp + FREE_LINKS);  //  남은 블록의 header 와 링크까지
+    }
+    else
+    {
+        // 남는 공간이 너무 작으면 블록 전체를 할당 (내부 단편화로 둔다)
+        PUT(HDRP(bp), PACK(block_size, 1) | PREV_ALLOC);
+        SET_PREV_ALLOC(HDRP(NEXT_BLKP(bp)));
+        touch_heap(ar, NEXT_BLKP(bp) + FREE_LINKS);
+    }
 }
 
-// 주어진 위치에 메모리를 배치 (필요 시 분할)
-void place(void *bp, size_t asize)
+/*
+ * trim_top - 병합이 끝난 free 블록 bp 가 힙의 마지막 블록이고 TRIM_THRESHOLD 이상이면
+ *     CHUNKSIZE 만 남기고 나머지를 brk 를 줄여 돌려준다. 문턱과 남기는 양의 차이가
+ *     히스테리시스가 되어, 같은 자리에서 늘였다 줄였다를 반복하지 않는다.
+ */
+static void trim_top(arena_t *ar, void *bp)
 {
-    size_t block_size = GET_SIZE(HDRP(bp));  // 현재 블록 전체 크기
+    size_t size = GET_SIZE(HDRP(bp));
+    size_t pagesize = mem_huge_page_size() ? mem_huge_page_size() : mem_pagesize();
+    size_t cut;
+    char *top;
 
-    // 현재 블록을 asize 크기로 할당 표시
-    PUT(HDRP(bp), PACK(asize, 1));
-    PUT(FTRP(bp), PACK(asize, 1));
+    if (size < TRIM_THRESHOLD || GET_SIZE(HDRP(NEXT_BLKP(bp))) != 0)
+        return;
 
-    // 남는 공간이 있을 경우, 새로운 free 블록으로 분할
-    if (block_size > asize)
-    {
-        // 다음 블록의 header/footer를 free 상태로 초기화
-        PUT(HDRP(NEXT_BLKP(bp)), PACK(block_size - asize, 0));
-        PUT(FTRP(NEXT_BLKP(bp)), PACK(block_size - asize, 0));
+    //  mem_sbrk 는 int 만큼씩 움직이므로 아주 큰 블록은 나머지를 다음 trim 에 맡긴다
+    cut = MIN(size - CHUNKSIZE, (size_t)INT_MAX & ~(size_t)(ALIGNMENT - 1));
+    remove_free_block(ar, bp);
+    if (mem_region_sbrk(ar->region, -(int)cut) == (void *)-1) {
+        insert_free_block(ar, bp);
+        return;
     }
+    PUT(HDRP(bp), PACK(size - cut, 0) | GET_PREV_ALLOC(HDRP(bp)));
+    PUT(FTRP(bp), PACK(size - cut, 0));
+    PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1));  //  새 epilogue (앞 블록은 free)
+    insert_free_block(ar, bp);
+
+    //  새 brk 가 걸친 페이지 위로는 돌려받은 페이지라 다시 0 이다
+    top = (char *)(((size_t)NEXT_BLKP(bp) + pagesize - 1) & ~(pagesize - 1));
+    if (ar->zero_from > top)
+        ar->zero_from = top;
 }
 
+/*
+ * release_pages - 큰 free 블록 bp 중 방금 free 된 [lo, hi) 부분의 페이지를 시스템에 돌려준다.
+ *     병합된 이웃은 이미 돌려준 상태이므로 다시 하지 않고, 이웃의 header/footer 가
+ *     있던 경계 페이지만 한 페이지씩 더 본다. bp 의 header 와 링크(리스트 pred/succ 나 트리 노드),
+ *     footer 가 있는 페이지는 남기므로 블록은 계속 가용 리스트에 있고,
+ *     나중에 할당되면 그 페이지들은 0 으로 다시 채워진다.
+ */
+static void release_pages(void *bp, char *lo, char *hi)
+{
+    size_t pagesize = mem_huge_page_size() ? mem_huge_page_size() : mem_pagesize();
 
+    if (GET_SIZE(HDRP(bp)) < RELEASE_THRESHOLD)
+        return;
+    lo = MAX(lo - pagesize, (char *)bp + FREE_LINKS);
+    hi = MIN(hi + pagesize, FTRP(bp));
+    mem_release_pages(lo, hi);
+}
 
-void *mm_malloc(size_t size)
+// 할당된 힙 블록 bp 를 free 로 표시하고 병합한다. 힙 꼭대기면 줄이고, 크면 안쪽 페이지를 돌려준다
+static void free_block(arena_t *ar, void *bp)
 {
-    size_t asize;
-    size_t extendsize;
-    char *bp;
+    size_t size = GET_SIZE(HDRP(bp));
+    char *lo;
 
-    if (size == 0) {
-        return NULL;
+    PUT(HDRP(bp), PACK(size, 0) | GET_PREV_ALLOC(HDRP(bp)));
+    PUT(FTRP(bp), PACK(size, 0));  //  free 가 되면서 footer 가 생긴다
+    lo = HDRP(bp);
+    bp = coalesce(ar, bp);
+    //  TLSF 는 free 한 번의 시간을 일정하게 두려고 brk 를 줄이거나 페이지를 돌려주지 않는다
+    if (!TLSF_ENGINE) {
+        trim_top(ar, bp);
+        release_pages(bp, lo, lo + size);
     }
+}
 
-    if (size <= DSIZE) {
-        asize = 2*DSIZE;
-    }
-    else {
-        asize = DSIZE * ((size + (DSIZE) + (DSIZE -1)) / DSIZE);
+/*
+ * quick list - 작은 힙 블록의 병합을 미룬다. 같은 크기를 free 하고 다시 malloc 하는
+ * 패턴에서는 free 때 병합하고 바로 다음 malloc 때 다시 분할하게 되므로, free 된 블록을
+ * 할당 상태 그대로 크기별 스택에 두었다가 같은 크기의 다음 요청에 그대로 준다.
+ * 할당 상태이므로 이웃 블록의 병합에도 끼지 않는다. 쌓인 블록은 다음 경우에만
+ * 한꺼번에 병합한다: 맞는 free 블록이 없을 때(힙을 늘리기 전), 쌓인 바이트가
+ * QUICK_BUDGET 을 넘었을 때.
+ */
+static int quick_index(size_t bsize)
+{
+    return (int)(bsize / ALIGNMENT) - 1;
+}
+
+// quick list 의 블록을 모두 free_block 으로 돌려준다. 병합, trim, 페이지 반납까지 여기서 한다
+static void quick_consolidate(arena_t *ar)
+{
+    void *bp, *next;
+    int idx;
+
+    for (idx = 0; idx < QUICK_BINS; idx++) {
+        for (bp = ar->quick[idx]; bp != NULL; bp = next) {
+            next = QUICK_NEXT(bp);
+            free_block(ar, bp);
+            ar->quick_merged++;
+        }
+        ar->quick[idx] = NULL;
     }
+    ar->quick_bytes = 0;
+    ar->quick_runs++;
+}
+
+// 할당된 힙 블록 bp 를 병합하지 않고 quick list 에 넣는다. 예산을 넘으면 모두 병합한다
+static void quick_push(arena_t *ar, void *bp)
+{
+    size_t bsize = GET_SIZE(HDRP(bp));
+    int idx = quick_index(bsize);
+
+    QUICK_NEXT(bp) = ar->quick[idx];
+    ar->quick[idx] = bp;
+    ar->quick_bytes += bsize;
+    ar->quick_frees++;
+    if (ar->quick_bytes > QUICK_BUDGET)
+        quick_consolidate(ar);
+}
+
+// 블록 크기가 정확히 asize 인 블록이 quick list 에 있으면 그대로 꺼낸다 (병합/분할 한 쌍을 아낀다)
+static void *quick_pop(arena_t *ar, size_t asize)
+{
+    int idx = quick_index(asize);
+    void *bp;
+
+    if ((bp = ar->quick[idx]) == NULL)
+        return NULL;
+    ar->quick[idx] = QUICK_NEXT(bp);
+    ar->quick_bytes -= asize;
+    ar->quick_hits++;
+    return bp;
+}
+
+// 블록 크기 asize 의 힙 블록을 할당한다. 맞는 free 블록이 없으면 quick list 를 병합해 보고, 그래도 없으면 힙을 늘린다
+static void *malloc_block(arena_t *ar, size_t asize)
+{
+    size_t extendsize, huge, aligned;
+    char *bp, *brk;
 
-    if ((bp = find_fit(asize)) != NULL) {
-        place(bp, asize);
+    //  맞는 free 블록이 없으면 힙을 늘리기 전에 미뤄 둔 병합부터 한다
+    if ((bp = find_fit(ar, asize)) == NULL && ar->quick_bytes > 0) {
+        quick_consolidate(ar);
+        bp = find_fit(ar, asize);
+    }
+    if (bp != NULL) {
+        place(ar, bp, asize);
         return bp;
     }
 
     extendsize = MAX(asize, CHUNKSIZE);
-    if ((bp = extend_heap(extendsize/WSIZE)) == NULL) {
+    if ((huge = mem_huge_page_size()) != 0) {
+        //  huge page 로 받는 중이면 새 brk 가 huge page 경계에 오도록 더 늘려서 한 장을 통째로 쓴다.
+        //  작은 힙이라 영역을 넘어가면 그냥 필요한 만큼만 늘린다
+        brk = (char *)mem_region_hi(ar->region) + 1;
+        aligned = (((size_t)brk + extendsize + huge - 1) & ~(huge - 1)) - (size_t)brk;
+        if (brk + aligned <= (char *)mem_region_lo(ar->region) + ar->limit)
+            extendsize = aligned;
+    }
+    if ((bp = extend_heap(ar, extendsize/WSIZE)) == NULL) {
         return NULL;
     }
-    place(bp, asize);
+    place(ar, bp, asize);
     return bp;
 }
 
-/*
- * mm_free - Freeing a block does nothing.
- */
-void mm_free(void *ptr)
+// 할당 블록 bp 를 asize 로 줄이고, 남는 부분이 최소 블록 이상이면 free 블록으로 떼어낸다
+static void shrink_block(arena_t *ar, void *bp, size_t asize)
 {
-    size_t size = GET_SIZE(HDRP(ptr));
+    size_t block_size = GET_SIZE(HDRP(bp));
+
+    if (block_size - asize < MIN_BLK_SIZE)
+        return;  // 떼어낼 만큼 남지 않으면 그대로 둔다
+
+    PUT(HDRP(bp), PACK(asize, 1) | GET_PREV_ALLOC(HDRP(bp)));
 
-    PUT(HDRP(ptr), PACK(size, 0));
-    PUT(FTRP(ptr), PACK(size, 0));
-    coalesce(ptr);
+    bp = NEXT_BLKP(bp);
+    PUT(HDRP(bp), PACK(block_size - asize, 0) | PREV_ALLOC);
+    PUT(FTRP(bp), PACK(block_size - asize, 0));
+    coalesce(ar, bp);  // 뒤 블록이 free 면 합쳐서 리스트에 넣는다
 }
 
-/*
- * mm_realloc - Implemented simply in terms of mm_malloc and mm_free
- */
-void *mm_realloc(void *ptr, size_t size)
+// free 블록 bp 안에서 payload 주소가 align 의 배수가 되는 첫 위치.
+// bp 가 이미 맞으면 bp, 아니면 앞쪽 조각이 최소 블록 이상 되도록 그 다음 배수
+static char *aligned_payload(void *bp, size_t align)
 {
-    void *oldptr = ptr;
-    void *newptr;
-    size_t copySize;
-    newptr = mm_malloc(size);
-    if (newptr == NULL)
-      return NULL;
-    copySize = GET_SIZE(HDRP(oldptr)) - DSIZE;
-    if (size < copySize)
-      copySize = size;
-    memcpy(newptr, oldptr, copySize);
-    mm_free(oldptr);
-    return newptr;
+    if ((size_t)bp % align == 0)
+        return bp;
+    return (char *)(((size_t)bp + MIN_BLK_SIZE + align - 1) & ~(align - 1));
 }
 
+// 앞쪽 조각을 떼고도 정렬된 payload 에 asize 가 들어가는 free 블록을 찾는다.
+// asize 의 리스트부터 넉넉한 크기 wsize 의 리스트까지 (큰 블록은 트리까지), 리스트마다 앞쪽 ALIGNED_FIT_SCAN 개만 본다
+static void *find_fit_aligned(arena_t *ar, size_t align, size_t asize, size_t wsize)
+{
+    int idx, last = list_index(wsize), n;
+    char *bp;
+
+    for (idx = list_index(asize); idx <= last; idx++) {
+        for (bp = ar->free_lists[idx], n = 0; bp != NULL && n < ALIGNED_FIT_SCAN; bp = SUCC(bp), n++) {
+            if (aligned_payload(bp, align) - bp + asize <= GET_SIZE(HDRP(bp)))
+                return bp;
+        }
+    }
+#ifndef MM_TLSF
+    //  큰 블록은 트리에서 크기 순으로 ALIGNED_FIT_SCAN 개까지
+    if (wsize > TREE_LIMIT) {
+        for (bp = tree_best_fit(ar, MAX(asize, TREE_LIMIT + 1)), n = 0; bp != NULL && n < ALIGNED_FIT_SCAN; bp = tree_next(bp), n++) {
+            if (aligned_payload(bp, align) - bp + asize <= GET_SIZE(HDRP(bp)))
+                return bp;
+        }
+    }
+#endif
+    return NULL;
+}
+
+// payload 주소가 align(2의 거듭제곱) 의 배수인 힙 블록을 할당한다.
+// 정렬된 payload 가 바로 들어가는 free 블록이 없으면 앞쪽 조각까지 들어갈 만큼 넉넉한 블록을 잡는다.
+// 어느 쪽이든 앞쪽 남는 부분은 free 블록으로, 뒤쪽 남는 부분은 shrink_block 으로 돌려준다
+static void *alloc_aligned(arena_t *ar, size_t align, size_t size)
+{
+    size_t asize = adjust_size(size);
+    size_t wsize = adjust_size(size + align + MIN_BLK_SIZE);
+    size_t total, lead;
+    char *bp, *abp;
+
+    if ((bp = find_fit_aligned(ar, align, asize, wsize)) != NULL)
+        place(ar, bp, GET_SIZE(HDRP(bp)));  //  블록 전체를 할당 상태로
+    else if ((bp = malloc_block(ar, wsize)) == NULL)
+        return NULL;
+
+    abp = aligned_payload(bp, align);
+    lead = abp - bp;
+
+    if (lead > 0) {
+        total = GET_SIZE(HDRP(bp));
+        PUT(HDRP(abp), PACK(total - lead, 1));  //  앞쪽 조각이 free 가 되므로 PREV_ALLOC 은 끈다
+        PUT(HDRP(bp), PACK(lead, 0) | GET_PREV_ALLOC(HDRP(bp)));
+        PUT(FTRP(bp), PACK(lead, 0));
+        coalesce(ar, bp);  //  앞쪽 조각은 그 앞 free 블록과 합쳐질 수 있다
+    }
+    shrink_block(ar, abp, asize);
+    return abp;
+}
+
+/*
+ * 슬랩(slab) - SLAB_MAX 바이트 이하의 작은 요청 전용 할당기.
+ *
+ * 한 페이지(SLAB_RUN_SIZE) 크기의 run 하나가 한 크기 클래스의 오브젝트만
+ * 담는다. run 은 페이지 경계에 맞춘 힙 블록이고, 맨 앞의 slab_run_t 에
+ * 오브젝트 사용 비트맵이 있어서 오브젝트마다 header 가 필요 없다.
+ * 포인터의 주인 run 은 주소 하위 비트를 잘라서(마스킹) 바로 찾고,
+ * 그 페이지가 run 인지는 힙 페이지별 비트맵(ar->run_map)으로 확인한다.
+ */
+static int slab_class(size_t size)
+{
+    return (int)((size - 1) / ALIGNMENT);  //  8, 16, ..., 64 => 0 ~ 7
+}
+
+#define SLAB_CLASS_SIZE(cls) (((cls) + 1) * ALIGNMENT)
+#define SLAB_RUNP(p) ((slab_run_t *)((size_t)(p) & ~(size_t)(SLAB_RUN_SIZE - 1)))  //  p 가 들어있는 run
+
+//  p 가 들어있는 페이지의 ar->run_map 위치 (힙 시작 페이지 기준)
+#define RUN_PAGE(ar, p) (((size_t)(p) / SLAB_RUN_SIZE) - ((size_t)mem_region_lo((ar)->region) / SLAB_RUN_SIZE))
+
+static int is_slab_ptr(arena_t *ar, void *p)
+{
+    size_t page = RUN_PAGE(ar, p);
+    //  mm_free 가 락 없이 부르므로 원자적으로 읽는다. 같은 바이트의 다른 페이지 비트는 락을 잡은 쪽이 바꿀 수 있다
+    return (__atomic_load_n(&ar->run_map[page / 8], __ATOMIC_RELAXED) >> (page % 8)) & 1;
+}
+
+//  run 을 클래스의 partial 리스트(빈 칸이 있는 run 들) 맨 앞에 넣는다
+static void slab_push_partial(arena_t *ar, slab_run_t *run)
+{
+    run->prev = NULL;
+    run->next = ar->slab_partial[run->cls];
+    if (run->next != NULL)
+        run->next->prev = run;
+    ar->slab_partial[run->cls] = run;
+}
+
+static void slab_remove_partial(arena_t *ar, slab_run_t *run)
+{
+    if (run->prev != NULL)
+        run->prev->next = run->next;
+    else
+        ar->slab_partial[run->cls] = run->next;
+    if (run->next != NULL)
+        run->next->prev = run->prev;
+}
+
+//  클래스 cls 용 새 run 을 힙에서 받아 초기화한다
+static slab_run_t *slab_new_run(arena_t *ar, int cls)
+{
+    slab_run_t *run;
+    size_t page;
+    int i;
+
+    if ((run = alloc_aligned(ar, SLAB_RUN_SIZE, SLAB_RUN_SIZE)) == NULL)
+        return NULL;
+
+    run->cls = cls;
+    //  2의 거듭제곱 크기 클래스는 첫 오브젝트를 그 크기 배수에 두어 모든 오브젝트가 자기 크기로 정렬되게 한다
+    //  (mm_memalign 이 작은 정렬 요청을 슬랩으로 보낼 수 있도록)
+    run->first = SLAB_HDR_SIZE;
+    if ((SLAB_CLASS_SIZE(cls) & (SLAB_CLASS_SIZE(cls) - 1)) == 0)
+        run->first = (SLAB_HDR_SIZE + SLAB_CLASS_SIZE(cls) - 1) & ~(SLAB_CLASS_SIZE(cls) - 1);
+    run->nobjs = (SLAB_RUN_SIZE - run->first) / SLAB_CLASS_SIZE(cls);
+    run->nfree = run->nobjs;
+    //  run 에 없는 칸(nobjs 이후)은 미리 사용 중으로 표시해 두면 할당 때 범위 검사가 필요 없다
+    for (i = 0; i < SLAB_MAP_WORDS; i++) {
+        if ((i + 1) * 64 <= run->nobjs)
+            run->used[i] = 0;
+        else if (i * 64 >= run->nobjs)
+            run->used[i] = ~0ULL;
+        else
+            run->used[i] = ~0ULL << (run->nobjs - i * 64);
+    }
+
+    page = RUN_PAGE(ar, run);
+    __atomic_fetch_or(&ar->run_map[page / 8], 1 << (page % 8), __ATOMIC_RELAXED);
+    ar->run_map_used = MAX(ar->run_map_used, page / 8 + 1);
+    slab_push_partial(ar, run);
+    return run;
+}
+
+static void *slab_alloc(arena_t *ar, size_t size)
+{
+    int cls = slab_class(size);
+    slab_run_t *run = ar->slab_partial[cls];
+    int i, bit;
+
+    if (run == NULL && (run = slab_new_run(ar, cls)) == NULL)
+        return NULL;
+
+    //  비트맵에서 비어있는 첫 칸을 찾는다
+    for (i = 0; run->used[i] == ~0ULL; i++)
+        ;
+    bit = __builtin_ctzll(~run->used[i]);
+    run->used[i] |= 1ULL << bit;
+
+    if (--run->nfree == 0)
+        slab_remove_partial(ar, run);  //  꽉 찬 run 은 partial 리스트에서 뺀다
+    return (char *)run + run->first + (size_t)(i * 64 + bit) * SLAB_CLASS_SIZE(cls);
+}
+
+// 클래스의 run 들에서 빈 칸을 비트맵 워드 단위로 한꺼번에 가져와 최대 n 개를 out 에 채운다
+static size_t slab_alloc_batch(arena_t *ar, size_t size, void **out, size_t n)
+{
+    int cls = slab_class(size);
+    slab_run_t *run;
+    unsigned long long avail;
+    size_t got = 0;
+    int i, bit;
+
+    while (got < n) {
+        if ((run = ar->slab_partial[cls]) == NULL && (run = slab_new_run(ar, cls)) == NULL)
+            break;
+        for (i = 0; i < SLAB_MAP_WORDS && got < n && run->nfree > 0; i++) {
+            avail = ~run->used[i];
+            while (avail != 0 && got < n) {
+                bit = __builtin_ctzll(avail);
+                avail &= avail - 1;
+                run->used[i] |= 1ULL << bit;
+                run->nfree--;
+                out[got++] = (char *)run + run->first + (size_t)(i * 64 + bit) * SLAB_CLASS_SIZE(cls);
+            }
+        }
+        if (run->nfree == 0)
+            slab_remove_partial(ar, run);
+    }
+    return got;
+}
+
+static void slab_free(arena_t *ar, void *p)
+{
+    slab_run_t *run = SLAB_RUNP(p);
+    size_t idx = ((char *)p - (char *)run - run->first) / SLAB_CLASS_SIZE(run->cls);
+    size_t page;
+
+    run->used[idx / 64] &= ~(1ULL << (idx % 64));
+    if (run->nfree++ == 0)
+        slab_push_partial(ar, run);  //  꽉 차 있던 run 에 빈 칸이 생겼다
+
+    //  완전히 빈 run 은 힙에 돌려준다. 단, 클래스의 마지막 partial run 이면 다음 할당을 위해 남겨둔다
+    if (run->nfree == run->nobjs && (run->prev != NULL || run->next != NULL)) {
+        slab_remove_partial(ar, run);
+        page = RUN_PAGE(ar, run);
+        __atomic_fetch_and(&ar->run_map[page / 8], ~(1 << (page % 8)), __ATOMIC_RELAXED);
+        free_block(ar, run);
+    }
+}
+
+// SLAB_MAX 이하의 요청은 슬랩에서, 나머지는 quick list 나 분리 가용 리스트(또는 TLSF)로 관리되는 힙 블록에서 할당한다
+static void *heap_malloc(arena_t *ar, size_t size)
+{
+    size_t asize;
+    void *bp;
+
+    if (size == 0) {
+        return NULL;
+    }
+
+    if (size <= SLAB_MAX)
+        return slab_alloc(ar, size);
+    if ((asize = adjust_size(size)) == 0)
+        return NULL;
+    if (!TLSF_ENGINE && asize <= QUICK_MAX_BLK && (bp = quick_pop(ar, asize)) != NULL)
+        return bp;
+    return malloc_block(ar, asize);
+}
+
+/*
+ * heap_malloc_batch - size 바이트 블록을 최대 n 개 할당해 out 에 채우고 개수를 돌려준다.
+ *     힙 블록은 k 개 분량이 한 번에 들어가는 free 블록을 찾아 place 한 번으로 떼어 낸 뒤
+ *     header 만 써서 k 개로 나눈다. k 개가 들어가는 블록이 없으면 k 를 절반씩 줄여 보고,
+ *     두 개도 안 들어가면 (남은 free 블록이 조각뿐이면) 힙을 늘려서 떼어 낸다.
+ */
+static size_t heap_malloc_batch(arena_t *ar, size_t size, void **out, size_t n)
+{
+    size_t asize, total, k, j, i, got = 0;
+    char *bp;
+    unsigned int prev;
+
+    if (size <= SLAB_MAX)
+        return slab_alloc_batch(ar, size, out, n);
+
+    if ((asize = adjust_size(size)) == 0)
+        return 0;
+    while (got < n) {
+        k = MIN(n - got, BATCH_CARVE / asize);
+        bp = NULL;
+        for (j = k; j >= 2 && (bp = find_fit(ar, j * asize)) == NULL; j /= 2)
+            ;
+        if (bp != NULL) {
+            k = j;
+            place(ar, bp, k * asize);
+        } else if (k < 2 || (bp = malloc_block(ar, k * asize)) == NULL) {
+            //  한 개짜리 묶음이거나 영역이 모자라면 하나씩
+            if ((out[got] = malloc_block(ar, asize)) == NULL)
+                break;
+            got++;
+            continue;
+        }
+        total = GET_SIZE(HDRP(bp));  //  떼어 낼 수 없이 작게 남은 부분은 마지막 블록이 갖는다
+        prev = GET_PREV_ALLOC(HDRP(bp));
+        for (i = 0; i < k; i++, bp += asize) {
+            PUT(HDRP(bp), PACK(i == k - 1 ? total - (k - 1) * asize : asize, 1) | (i == 0 ? prev : PREV_ALLOC));
+            out[got++] = bp;
+        }
+    }
+    return got;
+}
+
+// 슬랩 오브젝트는 run 비트맵에서 지우고, 작은 힙 블록은 quick list 에 넣고 (TLSF 빌드 제외),
+// 나머지 힙 블록은 가용 상태로 표시하고 병합한 뒤 가용 리스트에 넣는다
+static void heap_free(arena_t *ar, void *ptr)
+{
+    if (is_slab_ptr(ar, ptr))
+        slab_free(ar, ptr);
+    else if (!TLSF_ENGINE && GET_SIZE(HDRP(ptr)) <= QUICK_MAX_BLK)
+        quick_push(ar, ptr);
+    else
+        free_block(ar, ptr);
+}
+
+// 할당된 ptr 에 쓸 수 있는 바이트 수. 락 없이 불러도 된다
+static size_t heap_usable_size(arena_t *ar, void *ptr)
+{
+    if (is_slab_ptr(ar, ptr))
+        return SLAB_CLASS_SIZE(SLAB_RUNP(ptr)->cls);
+    return GET_SIZE_UNLOCKED(HDRP(ptr)) - WSIZE;
+}
+
+/*
+ * resize_block - 힙 블록 ptr 의 크기를 새 블록으로 복사하지 않고 바꾼다.
+ *     다음 순서로 시도하고, 모두 안 되면 NULL 을 돌려준다.
+ *     1. 줄이는 경우: 제자리에서 분할
+ *     2. 바로 뒤 블록이 free 이고 합치면 충분한 경우: 흡수
+ *     3. 블록이 힙의 마지막인 경우(뒤가 epilogue 이거나 마지막 free 블록): 모자란 만큼만 힙 확장 후 흡수
+ *     4. 앞 블록까지 free 이고 합치면 충분한 경우: 앞으로 당겨서 memmove
+ */
+static void *resize_block(arena_t *ar, void *ptr, size_t size)
+{
+    void *next, *ext;
+    void *newptr;
+    size_t asize, oldsize, avail;
+
+    //  넘치는 크기를 줄이는 경우로 착각하지 않도록 먼저 거른다
+    if ((asize = adjust_size(size)) == 0)
+        return NULL;
+    oldsize = GET_SIZE(HDRP(ptr));
+
+    // 1. 현재 블록으로 충분하면 남는 꼬리만 잘라낸다
+    if (asize <= oldsize) {
+        shrink_block(ar, ptr, asize);
+        return ptr;
+    }
+
+    next = NEXT_BLKP(ptr);
+    avail = oldsize + (GET_ALLOC(HDRP(next)) ? 0 : GET_SIZE(HDRP(next)));
+
+    // 3. 뒤에 더 이상 할당 블록이 없으면 모자란 만큼만 힙을 늘린다 (늘어난 부분은 next 와 병합됨)
+    if (avail < asize &&
+        (GET_SIZE(HDRP(next)) == 0 ||
+         (!GET_ALLOC(HDRP(next)) && GET_SIZE(HDRP(NEXT_BLKP(next))) == 0))) {
+        //  늘어난 부분도 잠시 free 블록이 되므로 최소 블록 크기 이상은 늘린다
+        if ((ext = extend_heap(ar, MAX(asize - avail, MIN_BLK_SIZE) / WSIZE)) != NULL) {
+            next = ext;
+            avail = oldsize + GET_SIZE(HDRP(next));
+        }
+    }
+
+    // 2. 뒤 free 블록을 흡수해서 충분해지면 제자리에서 키운다
+    if (avail >= asize) {
+        remove_free_block(ar, next);
+        PUT(HDRP(ptr), PACK(avail, 1) | GET_PREV_ALLOC(HDRP(ptr)));
+        SET_PREV_ALLOC(HDRP(NEXT_BLKP(ptr)));
+        touch_heap(ar, NEXT_BLKP(ptr) + FREE_LINKS);
+        shrink_block(ar, ptr, asize);
+        return ptr;
+    }
+
+    // 4. 앞 블록이 free 이고 앞뒤를 모두 합치면 충분한 경우: 앞으로 당겨서 memmove
+    //    (새 블록을 찾아 memcpy 하는 것과 비용은 같지만 힙을 늘리지 않는다)
+    if (!GET_PREV_ALLOC(HDRP(ptr)) &&
+        avail + GET_SIZE(HDRP(PREV_BLKP(ptr))) >= asize) {
+        newptr = PREV_BLKP(ptr);
+        avail += GET_SIZE(HDRP(newptr));
+        remove_free_block(ar, newptr);
+        if (!GET_ALLOC(HDRP(next)))
+            remove_free_block(ar, next);
+        memmove(newptr, ptr, oldsize - WSIZE);
+        PUT(HDRP(newptr), PACK(avail, 1) | PREV_ALLOC);
+        SET_PREV_ALLOC(HDRP(NEXT_BLKP(newptr)));
+        touch_heap(ar, NEXT_BLKP(newptr) + FREE_LINKS);
+        shrink_block(ar, newptr, asize);
+        return newptr;
+    }
+    return NULL;
+}
+
+// 슬랩 오브젝트는 같은 클래스면 그대로 두고, 힙 블록은 resize_block 으로 바꾼다. 안 되면 새 블록으로 복사
+static void *heap_realloc(arena_t *ar, void *ptr, size_t size)
+{
+    void *newptr;
+    size_t oldsize, copySize;
+
+    if (is_slab_ptr(ar, ptr)) {
+        oldsize = SLAB_CLASS_SIZE(SLAB_RUNP(ptr)->cls);
+        if (size <= oldsize && slab_class(size) == SLAB_RUNP(ptr)->cls)
+            return ptr;
+        if ((newptr = heap_malloc(ar, size)) == NULL)
+            return NULL;
+        memcpy(newptr, ptr, size < oldsize ? size : oldsize);
+        slab_free(ar, ptr);
+        return newptr;
+    }
+
+    if ((newptr = resize_block(ar, ptr, size)) != NULL)
+        return newptr;
+
+    // 제자리에서 안 되면 새 블록에 복사
+    oldsize = GET_SIZE(HDRP(ptr));
+    newptr = heap_malloc(ar, size);
+    if (newptr == NULL)
+      return NULL;
+    copySize = oldsize - WSIZE;
+    if (size < copySize)
+      copySize = size;
+    memcpy(newptr, ptr, copySize);
+    free_block(ar, ptr);
+    return newptr;
+}
+
+/*
+ * 큰 블록의 mmap 경로 - 블록 하나에 매핑 하나. 매핑 앞부분에 header 한 워드를
+ * 두고 MAPPED 비트로 표시한다. 힙 영역 밖이므로 arena_of 가 NULL 을 돌려주고,
+ * 그때 header 를 보고 매핑 블록인지 가린다.
+ */
+#ifndef MMAP_THRESHOLD
+#define MMAP_THRESHOLD (128 * 1024)  //  이 크기 이상은 기본으로 mmap 경로 (mm_set_mmap_threshold 로 변경)
+#endif
+#define MMAP_OFFSET ALIGNMENT        //  매핑 시작에서 payload 까지 (header 한 워드 + 정렬)
+#define MMAP_BASE(bp) ((char *)(bp) - MMAP_OFFSET)
+#define IS_MAPPED(bp) (GET(HDRP(bp)) & MAPPED)
+
+static size_t mmap_threshold = MMAP_THRESHOLD;
+
+static void *mmap_malloc(size_t size)
+{
+    char *bp;
+
+    if (size > (size_t)-1 - MMAP_OFFSET)
+        return NULL;  //  header 를 더하면 넘친다
+    if ((bp = mem_map(size + MMAP_OFFSET)) == NULL)
+        return NULL;
+    bp += MMAP_OFFSET;
+    PUT(HDRP(bp), PACK(0, 1) | MAPPED);
+    return bp;
+}
+
+static size_t mmap_usable_size(void *bp)
+{
+    return mem_map_size(MMAP_BASE(bp)) - MMAP_OFFSET;
+}
+
+/*
+ * 아레나 배정과 찾기.
+ *
+ * arenas[0] 은 mm_init 이 mem_init 의 기본 영역 위에 만들고, 나머지는 스레드가
+ * 처음 배정될 때 mem_region_create 로 새 영역을 받아 만든다. 아레나는 한 번
+ * 만들어지면 없어지지 않으므로(mm_init 은 비우기만 한다) 스레드는 배정받은
+ * 포인터를 계속 들고 있어도 된다.
+ */
+static int arena_create(mem_region_t *region)
+{
+    arena_t *ar = &arenas[num_arenas];
+
+    pthread_mutex_init(&ar->lock, NULL);
+    ar->region = region;
+    ar->limit = mem_region_limit(region);
+    //  영역 크기는 실행 중에 정해지므로 run_map 도 따로 받는다. 건드린 페이지만 메모리를 쓴다
+    if ((ar->run_map = mem_reserve(RUN_MAP_SIZE(ar->limit))) == NULL)
+        return -1;
+    if (heap_init(ar) == -1)
+        return -1;
+    //  다른 스레드가 락 없이 arena_of 로 읽으므로 아레나를 다 만든 뒤에 수를 늘린다
+    __atomic_store_n(&num_arenas, num_arenas + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// 새 영역을 받아 아레나를 하나 더 만든다. arenas_lock 을 잡고 부른다
+static int arena_add(void)
+{
+    mem_region_t *region;
+
+    if (num_arenas == MAX_ARENAS || (region = mem_region_create(mem_heap_limit())) == NULL)
+        return -1;
+    return arena_create(region);
+}
+
+// 현재 스레드의 아레나. 처음이면 라운드 로빈으로 하나 배정하고, 필요하면 새로 만든다
+static arena_t *arena_get(void)
+{
+    int idx;
+
+    if (thread_arena != NULL)
+        return thread_arena;
+
+    idx = __atomic_fetch_add(&next_arena, 1, __ATOMIC_RELAXED) % max_arenas;
+    pthread_mutex_lock(&arenas_lock);
+    while (idx >= num_arenas) {
+        //  영역이 모자라면 이미 있는 아레나를 나눠 쓴다
+        if (arena_add() == -1) {
+            idx %= num_arenas;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&arenas_lock);
+    thread_arena = &arenas[idx];
+    return thread_arena;
+}
+
+// 다른 아레나의 블록 bp 를 그 아레나의 remote_free 스택에 락 없이 넣는다
+static void remote_free_push(arena_t *ar, void *bp)
+{
+    void *head = __atomic_load_n(&ar->remote_free, __ATOMIC_RELAXED);
+
+    do {
+        TCACHE_NEXT(bp) = head;
+    } while (!__atomic_compare_exchange_n(&ar->remote_free, &head, bp, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+// remote_free 스택을 통째로 떼어 와서 모두 힙에 돌려준다. ar 의 락을 잡고 부른다
+static void arena_drain(arena_t *ar)
+{
+    void *bp, *next;
+
+    if (__atomic_load_n(&ar->remote_free, __ATOMIC_RELAXED) == NULL)
+        return;
+    //  떼어 낸 리스트는 이제 혼자만 보므로 ABA 걱정 없이 따라가면 된다
+    bp = __atomic_exchange_n(&ar->remote_free, NULL, __ATOMIC_ACQUIRE);
+    for (; bp != NULL; bp = next) {
+        next = TCACHE_NEXT(bp);
+        heap_free(ar, bp);
+    }
+}
+
+/*
+ * arena_retry_malloc - 아레나 full 의 영역이 가득 차서 할당에 실패했을 때,
+ *     다른 아레나에서 (모두 안 되면 아레나를 새로 만들어서) 할당한다.
+ *     성공한 아레나를 이 스레드의 아레나로 바꾼다.
+ */
+static void *arena_retry_malloc(arena_t *full, size_t size)
+{
+    arena_t *ar;
+    void *bp;
+    int i;
+
+    for (i = 0; i < MAX_ARENAS; i++) {
+        if (i >= __atomic_load_n(&num_arenas, __ATOMIC_ACQUIRE)) {
+            pthread_mutex_lock(&arenas_lock);
+            if (i >= num_arenas && arena_add() == -1) {
+                pthread_mutex_unlock(&arenas_lock);
+                return NULL;
+            }
+            pthread_mutex_unlock(&arenas_lock);
+        }
+        if ((ar = &arenas[i]) == full)
+            continue;
+        pthread_mutex_lock(&ar->lock);
+        arena_drain(ar);
+        bp = heap_malloc(ar, size);
+        pthread_mutex_unlock(&ar->lock);
+        if (bp != NULL) {
+            thread_arena = ar;
+            return bp;
+        }
+    }
+    return NULL;
+}
+
+// 블록 ptr 을 할당한 아레나. 어느 영역에도 속하지 않으면 NULL
+static arena_t *arena_of(void *ptr)
+{
+    int n = __atomic_load_n(&num_arenas, __ATOMIC_ACQUIRE);
+    char *lo;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        lo = mem_region_lo(arenas[i].region);
+        if ((char *)ptr >= lo && (char *)ptr < lo + arenas[i].limit)
+            return &arenas[i];
+    }
+    return NULL;
+}
+
+/*
+ * 스레드 캐시(tcache) - 스레드마다 최근에 free 된 작은 블록을 크기별로 조금씩 들고 있다.
+ *
+ * 캐시에 있는 블록은 힙에서는 계속 할당 상태로 보이므로(병합되지 않음),
+ * 같은 크기의 다음 malloc 은 락도 힙도 건드리지 않고 캐시에서 바로 꺼낸다.
+ * bin 하나에는 TCACHE_DEPTH 개까지만 두고, 넘치면 절반을 한 번에 돌려보낸다.
+ * 자기 아레나 블록은 락을 한 번만 잡고 heap_free 로, 다른 아레나 블록은 그
+ * 아레나의 remote_free 로 간다. 스레드가 끝날 때도 남은 블록을 모두 돌려준다.
+ * mm_init 이 힙을 새로 만들면 heap_epoch 가 바뀌어 이전 힙을 가리키는 캐시는 버려진다.
+ */
+static int tcache_index(size_t size)
+{
+    if (size <= SLAB_MAX)
+        return slab_class(size);
+    return SLAB_NUM_CLASSES + (int)((adjust_size(size) - TCACHE_MIN_BLK) / ALIGNMENT);
+}
+
+// 아레나 ar 에서 할당된 ptr 이 들어갈 bin. 캐시 대상이 아니면 -1
+static int tcache_index_of(arena_t *ar, void *ptr)
+{
+    size_t bsize;
+
+    if (is_slab_ptr(ar, ptr))
+        return SLAB_RUNP(ptr)->cls;
+    //  이웃 블록이 락을 잡고 PREV_ALLOC 비트만 바꿀 수 있지만 크기 비트는 그대로다
+    bsize = GET_SIZE_UNLOCKED(HDRP(ptr));
+    if (bsize < TCACHE_MIN_BLK || bsize > TCACHE_MAX_BLK)
+        return -1;  // realloc 으로 줄어든 작은 힙 블록이나 큰 블록은 캐시하지 않는다
+    return SLAB_NUM_CLASSES + (int)((bsize - TCACHE_MIN_BLK) / ALIGNMENT);
+}
+
+// 현재 스레드 캐시가 지금 힙의 것인지 확인하고, 아니면 비운다
+static tcache_t *tcache_get(void)
+{
+    unsigned int epoch = __atomic_load_n(&heap_epoch, __ATOMIC_ACQUIRE);
+
+    if (tcache.epoch != epoch) {
+        memset(&tcache, 0, sizeof(tcache));
+        tcache.epoch = epoch;
+    }
+    if (!tcache.registered) {
+        //  스레드가 끝날 때 tcache_destroy 가 불리도록 등록
+        tcache.registered = 1;
+        pthread_setspecific(tcache_key, &tcache);
+    }
+    return &tcache;
+}
+
+// bin idx 에 keep 개만 남기고 나머지를 각자의 아레나에 돌려준다
+static void tcache_flush(tcache_t *tc, int idx, int keep)
+{
+    arena_t *ar, *own = thread_arena;
+    int locked = 0;
+    void *bp;
+
+    if (tc->epoch != __atomic_load_n(&heap_epoch, __ATOMIC_ACQUIRE))
+        return;  //  이미 버려진 힙의 캐시 (다음 tcache_get 이 비운다)
+
+    while (tc->count[idx] > keep) {
+        bp = tc->head[idx];
+        tc->head[idx] = TCACHE_NEXT(bp);
+        tc->count[idx]--;
+        if (idx >= SLAB_NUM_CLASSES)
+            tc->frees--;  //  여기서부터는 아레나의 free 로 센다 (quick list 에 들어가면 거기서)
+        if ((ar = arena_of(bp)) != own) {
+            remote_free_push(ar, bp);
+            continue;
+        }
+        if (!locked) {
+            pthread_mutex_lock(&own->lock);
+            arena_drain(own);
+            locked = 1;
+        }
+        heap_free(own, bp);
+    }
+    if (locked)
+        pthread_mutex_unlock(&own->lock);
+}
+
+// pthread 키 소멸자: 끝나는 스레드의 캐시를 모두 아레나로 돌려준다
+static void tcache_destroy(void *arg)
+{
+    tcache_t *tc = arg;
+    int idx;
+
+    for (idx = 0; idx < TCACHE_BINS; idx++)
+        if (tc->count[idx] > 0)
+            tcache_flush(tc, idx, 0);
+    if (tc->epoch == __atomic_load_n(&heap_epoch, __ATOMIC_ACQUIRE)) {
+        __atomic_fetch_add(&tcache_frees, tc->frees, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&tcache_hits, tc->hits, __ATOMIC_RELAXED);
+    }
+}
+
+static void tcache_init_key(void)
+{
+    pthread_key_create(&tcache_key, tcache_destroy);
+}
+
+//  환경 변수 MM_POLICY 가 가리키는 배치 정책. 없거나 모르는 이름이면 first-fit
+static int env_policy(void)
+{
+    const char *name = getenv("MM_POLICY");
+    int i;
+
+    for (i = 0; name != NULL && i < MM_NUM_POLICIES; i++) {
+        if (strcmp(name, mm_policy_name(i)) == 0)
+            return i;
+    }
+    return MM_FIRST_FIT;
+}
+
+/* 
+ * mm_init - initialize the malloc package.
+ *     처음에는 기본 영역에 아레나 0 을 만들고, 이후에는 있는 아레나를 모두 비운다.
+ */
+int mm_init(void)
+{
+    long ncpu;
+    int i, ret = 0;
+
+    pthread_once(&tcache_once, tcache_init_key);
+    if (fit_policy < 0)
+        fit_policy = env_policy();
+    mem_unmap_all();  //  이전 힙의 매핑 블록도 모두 돌려준다
+    pthread_mutex_lock(&arenas_lock);
+    if (num_arenas == 0) {
+        ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        max_arenas = ncpu < 1 ? 1 : ncpu > MAX_ARENAS ? MAX_ARENAS : (int)ncpu;
+        ret = arena_create(mem_default_region());
+    } else {
+        for (i = 0; i < num_arenas; i++)
+            pthread_mutex_lock(&arenas[i].lock);
+        __atomic_add_fetch(&heap_epoch, 1, __ATOMIC_RELEASE);  //  모든 스레드 캐시를 무효화
+        tcache_frees = tcache_hits = 0;
+        for (i = 0; i < num_arenas; i++) {
+            //  run_map 은 지금까지 쓴 앞부분만 지운다
+            memset(arenas[i].run_map, 0, arenas[i].run_map_used);
+            arenas[i].run_map_used = 0;
+            mem_region_reset(arenas[i].region);
+            arenas[i].remote_free = NULL;
+            if (heap_init(&arenas[i]) == -1)
+                ret = -1;
+            pthread_mutex_unlock(&arenas[i].lock);
+        }
+    }
+    pthread_mutex_unlock(&arenas_lock);
+    return ret;
+}
+
+// size 이상의 요청을 mmap 경로로 보낸다
+void mm_set_mmap_threshold(size_t size)
+{
+    mmap_threshold = size;
+}
+
+// 힙의 free 블록 배치 정책을 바꾼다. 모르는 정책이면 -1
+int mm_set_policy(mm_policy_t policy)
+{
+    if ((unsigned)policy >= MM_NUM_POLICIES)
+        return -1;
+    fit_policy = policy;
+    return 0;
+}
+
+// 배치 정책의 이름 (MM_POLICY 에 쓰는 이름). 모르는 정책이면 NULL
+const char *mm_policy_name(int policy)
+{
+    if ((unsigned)policy >= MM_NUM_POLICIES)
+        return NULL;
+    return policy_names[policy];
+}
+
+/* 
+ * mm_malloc - 큰 요청은 따로 매핑하고, 작은 요청은 먼저 스레드 캐시에서
+ *     꺼내고, 없으면 스레드의 아레나 락을 잡고 슬랩 또는 힙에서 할당한다.
+ */
+void *mm_malloc(size_t size)
+{
+    arena_t *ar;
+    tcache_t *tc;
+    void *bp;
+    int idx;
+
+    if (size == 0) {
+        return NULL;
+    }
+
+    //  매핑에 실패하면 힙에서라도 할당해 본다
+    if (size >= mmap_threshold && (bp = mmap_malloc(size)) != NULL)
+        return bp;
+    if (adjust_size(size) == 0)
+        return NULL;
+
+    if (size <= TCACHE_MAX) {
+        tc = tcache_get();
+        idx = tcache_index(size);
+        if ((bp = tc->head[idx]) != NULL) {
+            tc->head[idx] = TCACHE_NEXT(bp);
+            tc->count[idx]--;
+            if (idx >= SLAB_NUM_CLASSES)
+                tc->hits++;
+            return bp;
+        }
+    }
+
+    ar = arena_get();
+    pthread_mutex_lock(&ar->lock);
+    arena_drain(ar);
+    bp = heap_malloc(ar, size);
+    pthread_mutex_unlock(&ar->lock);
+    if (bp == NULL)
+        bp = arena_retry_malloc(ar, size);
+    return bp;
+}
+
+/*
+ * mm_calloc - nmemb * size 바이트를 0 으로 채워 할당한다. 새 매핑과, 영역을 늘린 뒤
+ *     한 번도 할당된 적 없는 zero_from 위쪽은 이미 0 이므로 memset 하지 않는다.
+ *     블록에서 zero_from 앞부분과, 블록 전체를 받았을 때 딸려 온 free 블록 footer 만 지운다.
+ */
+void *mm_calloc(size_t nmemb, size_t size)
+{
+    arena_t *ar;
+    char *bp, *zero_from, *ftr = NULL;
+
+    if (size != 0 && nmemb > (size_t)-1 / size)
+        return NULL;  //  nmemb * size 가 넘친다
+    if ((size *= nmemb) == 0)
+        return NULL;
+
+    if (size >= mmap_threshold && (bp = mmap_malloc(size)) != NULL)
+        return bp;  //  새 매핑은 전부 0
+
+    //  작은 블록은 캐시와 슬랩에서 계속 재사용되므로 그냥 지운다
+    if (size <= TCACHE_MAX) {
+        if ((bp = mm_malloc(size)) != NULL)
+            memset(bp, 0, size);
+        return bp;
+    }
+
+    ar = arena_get();
+    pthread_mutex_lock(&ar->lock);
+    arena_drain(ar);
+    zero_from = ar->zero_from;  //  할당하면서 올라가므로 먼저 읽어 둔다
+    if ((bp = heap_malloc(ar, size)) != NULL)
+        ftr = FTRP(bp);
+    pthread_mutex_unlock(&ar->lock);
+    if (bp == NULL) {
+        if ((bp = arena_retry_malloc(ar, size)) != NULL)
+            memset(bp, 0, size);
+        return bp;
+    }
+
+    zero_from = MIN(MAX(zero_from, bp), bp + size);
+    memset(bp, 0, zero_from - bp);
+    if (ftr >= zero_from)
+        PUT(ftr, 0);  //  payload 안쪽이므로 요청 크기를 넘어도 지워도 된다
+    return bp;
+}
+
+/*
+ * mm_free - 작은 블록은 스레드 캐시에 넣고(넘치면 절반을 한꺼번에 반납),
+ *     나머지는 자기 아레나 블록이면 락을 잡고 바로 돌려주고,
+ *     다른 아레나 블록이면 그 아레나의 remote_free 에 넣는다.
+ *     매핑 블록은 바로 unmap 한다.
+ */
+void mm_free(void *ptr)
+{
+    arena_t *ar;
+    tcache_t *tc;
+    int idx;
+
+    if (ptr == NULL)
+        return;
+    if ((ar = arena_of(ptr)) == NULL) {
+        if (IS_MAPPED(ptr))
+            mem_unmap(MMAP_BASE(ptr));
+        return;
+    }
+
+    if ((idx = tcache_index_of(ar, ptr)) >= 0) {
+        tc = tcache_get();
+        if (tc->count[idx] >= TCACHE_DEPTH)
+            tcache_flush(tc, idx, TCACHE_DEPTH / 2);
+        TCACHE_NEXT(ptr) = tc->head[idx];
+        tc->head[idx] = ptr;
+        tc->count[idx]++;
+        if (idx >= SLAB_NUM_CLASSES)
+            tc->frees++;
+        return;
+    }
+
+    if (ar != thread_arena) {
+        remote_free_push(ar, ptr);
+        return;
+    }
+    pthread_mutex_lock(&ar->lock);
+    arena_drain(ar);
+    heap_free(ar, ptr);
+    pthread_mutex_unlock(&ar->lock);
+}
+
+/*
+ * mmap_realloc - 매핑 블록의 크기를 바꾼다. 계속 큰 블록이면 mem_remap 으로
+ *     매핑째 늘리거나 줄이고(복사 없음), 작아지면 힙으로 옮긴다.
+ */
+static void *mmap_realloc(void *ptr, size_t size)
+{
+    char *base, *newptr;
+    size_t oldsize;
+
+    if (size < mmap_threshold) {
+        if ((newptr = mm_malloc(size)) == NULL)
+            return NULL;
+        oldsize = mmap_usable_size(ptr);
+        memcpy(newptr, ptr, size < oldsize ? size : oldsize);
+        mem_unmap(MMAP_BASE(ptr));
+        return newptr;
+    }
+    if (size > (size_t)-1 - MMAP_OFFSET || (base = mem_remap(MMAP_BASE(ptr), size + MMAP_OFFSET)) == NULL)
+        return NULL;
+    return base + MMAP_OFFSET;
+}
+
+/*
+ * mm_realloc - 블록의 아레나 락을 잡고 heap_realloc 으로 가능한 한 제자리에서 크기를 바꾼다.
+ *     threshold 를 넘게 커지는 힙 블록은 제자리에서 안 될 때만 매핑 블록으로 옮긴다.
+ */
+void *mm_realloc(void *ptr, size_t size)
+{
+    arena_t *ar;
+    void *newptr;
+    size_t oldsize;
+
+    if (ptr == NULL)
+        return mm_malloc(size);
+    if (size == 0) {
+        mm_free(ptr);
+        return NULL;
+    }
+    if ((ar = arena_of(ptr)) == NULL)
+        return IS_MAPPED(ptr) ? mmap_realloc(ptr, size) : NULL;
+    //  힙 블록으로 만들 수 없는 크기면 ptr 은 그대로 두고 실패
+    if (adjust_size(size) == 0)
+        return NULL;
+
+    if (size >= mmap_threshold && !is_slab_ptr(ar, ptr)) {
+        pthread_mutex_lock(&ar->lock);
+        arena_drain(ar);
+        newptr = resize_block(ar, ptr, size);
+        pthread_mutex_unlock(&ar->lock);
+        if (newptr != NULL)
+            return newptr;
+        if ((newptr = mmap_malloc(size)) != NULL) {
+            oldsize = heap_usable_size(ar, ptr);
+            memcpy(newptr, ptr, size < oldsize ? size : oldsize);
+            mm_free(ptr);
+            return newptr;
+        }
+    }
+
+    pthread_mutex_lock(&ar->lock);
+    arena_drain(ar);
+    newptr = heap_realloc(ar, ptr, size);
+    oldsize = heap_usable_size(ar, ptr);
+    pthread_mutex_unlock(&ar->lock);
+
+    //  블록의 아레나가 가득 찼으면 다른 아레나로 옮긴다 (ptr 은 그대로 남아 있다)
+    if (newptr == NULL && (newptr = arena_retry_malloc(ar, size)) != NULL) {
+        memcpy(newptr, ptr, size < oldsize ? size : oldsize);
+        mm_free(ptr);
+    }
+    return newptr;
+}
+
+/*
+ * mm_memalign - payload 주소가 alignment 의 배수인 블록을 할당한다.
+ *     2의 거듭제곱이 아닌 alignment 는 다음 2의 거듭제곱으로 올린다.
+ *     ALIGNMENT 이하의 정렬은 모든 블록이 이미 만족하므로 mm_malloc 과 같고,
+ *     SLAB_MAX 이하의 작은 요청은 자기 크기로 정렬되는 2의 거듭제곱 슬랩 클래스에서
+ *     header 없이 받는다. 나머지는 alloc_aligned 가 앞뒤 남는 부분을 free 블록으로 돌려준다.
+ */
+void *mm_memalign(size_t alignment, size_t size)
+{
+    arena_t *ar;
+    void *bp;
+
+    if (alignment > ((size_t)INT_MAX + 1) / 2)
+        return NULL;
+    if ((alignment & (alignment - 1)) != 0)
+        alignment = (size_t)1 << (8 * sizeof(unsigned long long) - __builtin_clzll(alignment));
+    if (size == 0 || size > (size_t)INT_MAX - alignment)
+        return NULL;
+    if (alignment <= ALIGNMENT)
+        return mm_malloc(size);
+    if (size <= SLAB_MAX && alignment <= SLAB_MAX) {
+        //  max(size, alignment) 이상의 가장 작은 2의 거듭제곱 클래스
+        size = MAX(size, alignment);
+        if ((size & (size - 1)) != 0)
+            size = (size_t)1 << (8 * sizeof(unsigned long long) - __builtin_clzll(size));
+        if (size < mmap_threshold)  //  매핑 블록은 ALIGNMENT 까지만 맞춰진다
+            return mm_malloc(size);
+    }
+
+    ar = arena_get();
+    pthread_mutex_lock(&ar->lock);
+    arena_drain(ar);
+    bp = alloc_aligned(ar, alignment, size);
+    pthread_mutex_unlock(&ar->lock);
+    return bp;
+}
+
+/*
+ * mm_free_sized - 크기를 아는 블록의 free. size 는 mm_malloc/mm_realloc 에 준 크기
+ *     (또는 그 이상 mm_usable_size 이하). SLAB_MAX 보다 크고 tcache 에 들어갈 크기면
+ *     header 도 주인 아레나도 보지 않고 size 의 bin 에 바로 넣는다. 그런 블록은 힙 블록이고
+ *     크기가 adjust_size(size) 이상이라, 그 bin 에서 다시 할당해도 된다.
+ *     SLAB_MAX 이하는 mm_free 가 블록의 진짜 bin 을 찾는다. 그 크기의 bin 은 슬랩 클래스라서
+ *     (올림한 크기, 자기 크기 정렬) memalign/realloc 으로 받은 작은 힙 블록을 넣으면 안 된다.
+ *     매핑 블록은 size 가 mmap_threshold 이상이므로 여기에 오지 않는다.
+ */
+void mm_free_sized(void *ptr, size_t size)
+{
+    tcache_t *tc;
+    int idx;
+
+    if (ptr == NULL)
+        return;
+    if (size <= SLAB_MAX || size > TCACHE_MAX || size >= mmap_threshold) {
+        mm_free(ptr);
+        return;
+    }
+
+    tc = tcache_get();
+    idx = tcache_index(size);
+    if (tc->count[idx] >= TCACHE_DEPTH)
+        tcache_flush(tc, idx, TCACHE_DEPTH / 2);
+    TCACHE_NEXT(ptr) = tc->head[idx];
+    tc->head[idx] = ptr;
+    tc->count[idx]++;
+    tc->frees++;  //  SLAB_MAX 이하는 위에서 mm_free 로 갔다
+}
+
+/*
+ * mm_malloc_batch - size 바이트 블록 n 개를 할당해 out[0..n-1] 에 넣고 할당한 개수를 돌려준다.
+ *     n 보다 적으면 메모리가 모자란 것이고, 나머지 칸은 건드리지 않는다.
+ *     스레드 캐시를 먼저 비우고, 나머지는 아레나 락을 한 번만 잡고 heap_malloc_batch 로 받는다.
+ */
+size_t mm_malloc_batch(size_t size, size_t n, void **out)
+{
+    arena_t *ar;
+    tcache_t *tc;
+    size_t got = 0;
+    int idx;
+
+    if (size == 0)
+        return 0;
+    if (size >= mmap_threshold) {  //  매핑 블록은 어차피 하나씩 매핑한다
+        while (got < n && (out[got] = mm_malloc(size)) != NULL)
+            got++;
+        return got;
+    }
+
+    if (size <= TCACHE_MAX) {
+        tc = tcache_get();
+        idx = tcache_index(size);
+        while (got < n && tc->head[idx] != NULL) {
+            out[got++] = tc->head[idx];
+            tc->head[idx] = TCACHE_NEXT(tc->head[idx]);
+            tc->count[idx]--;
+            if (idx >= SLAB_NUM_CLASSES)
+                tc->hits++;
+        }
+    }
+    if (got == n)
+        return got;
+
+    ar = arena_get();
+    pthread_mutex_lock(&ar->lock);
+    arena_drain(ar);
+    got += heap_malloc_batch(ar, size, out + got, n - got);
+    pthread_mutex_unlock(&ar->lock);
+    //  아레나가 가득 찼으면 나머지는 다른 아레나에서 하나씩
+    while (got < n && (out[got] = arena_retry_malloc(ar, size)) != NULL)
+        got++;
+    return got;
+}
+
+/*
+ * mm_free_batch - ptrs[0..n-1] 을 모두 free 한다 (NULL 은 건너뛴다).
+ *     스레드 캐시도 quick list 도 거치지 않고, 자기 아레나 블록은 락을 한 번만 잡고 힙에 바로 돌려준다.
+ *     다른 아레나 블록은 그 아레나의 remote_free 로, 매핑 블록은 바로 해제한다.
+ */
+void mm_free_batch(void **ptrs, size_t n)
+{
+    arena_t *ar, *own = thread_arena;
+    int locked = 0;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        if (ptrs[i] == NULL)
+            continue;
+        if ((ar = arena_of(ptrs[i])) == NULL) {
+            if (IS_MAPPED(ptrs[i]))
+                mem_unmap(MMAP_BASE(ptrs[i]));
+            continue;
+        }
+        if (ar != own) {
+            remote_free_push(ar, ptrs[i]);
+            continue;
+        }
+        if (!locked) {
+            pthread_mutex_lock(&own->lock);
+            arena_drain(own);
+            locked = 1;
+        }
+        //  quick list 를 거치지 않고 바로 병합한다. 묶음 할당이 이어진 큰 free 블록을 떼어 가도록
+        if (is_slab_ptr(own, ptrs[i]))
+            slab_free(own, ptrs[i]);
+        else
+            free_block(own, ptrs[i]);
+    }
+    if (locked)
+        pthread_mutex_unlock(&own->lock);
+}
+
+/*
+ * mm_aligned_alloc - C11 aligned_alloc. mm_memalign 과 같지만 alignment 가
+ *     2의 거듭제곱이 아니면 올리지 않고 NULL 을 돌려준다.
+ */
+void *mm_aligned_alloc(size_t alignment, size_t size)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+        return NULL;
+    return mm_memalign(alignment, size);
+}
+
+// 할당된 ptr 에 실제로 쓸 수 있는 바이트 수 (요청보다 클 수 있다)
+size_t mm_usable_size(void *ptr)
+{
+    arena_t *ar;
+
+    if (ptr == NULL)
+        return 0;
+    if ((ar = arena_of(ptr)) == NULL)
+        return IS_MAPPED(ptr) ? mmap_usable_size(ptr) : 0;
+    return heap_usable_size(ar, ptr);
+}
+
+/*
+ * mm_quick_stats - mm_init 이후 모든 아레나의 quick list 통계를 더해서 st 에 채운다.
+ *     hits 가 병합하고 바로 다시 분할하는 일을 아낀 횟수다. 스레드 캐시도 같은 일을
+ *     먼저 하므로 (같은 크기의 free/malloc 쌍은 대부분 캐시에서 끝난다) 캐시에 둔 힙 블록의
+ *     free 와 그것을 다시 준 malloc 도 더한다. 살아 있는 다른 스레드의 캐시는 그 스레드가
+ *     끝날 때 합쳐진다.
+ */
+void mm_quick_stats(mm_quick_stats_t *st)
+{
+    arena_t *ar;
+    tcache_t *tc = tcache_get();
+    int i, n = __atomic_load_n(&num_arenas, __ATOMIC_ACQUIRE);
+
+    memset(st, 0, sizeof(*st));
+    st->frees = tc->frees + __atomic_load_n(&tcache_frees, __ATOMIC_RELAXED);
+    st->hits = tc->hits + __atomic_load_n(&tcache_hits, __ATOMIC_RELAXED);
+    for (i = 0; i < n; i++) {
+        ar = &arenas[i];
+        pthread_mutex_lock(&ar->lock);
+        st->frees += ar->quick_frees;
+        st->hits += ar->quick_hits;
+        st->consolidations += ar->quick_runs;
+        st->consolidated += ar->quick_merged;
+        pthread_mutex_unlock(&ar->lock);
+    }
+}
+
+/*
+ * fork 대비 - mm_prefork 는 모든 아레나 락과 memlib 의 락을 잡아서, fork 하는 순간
+ *     다른 스레드가 힙을 고치던 중이 아니게 한다. fork 가 끝나면 부모와 자식 모두
+ *     mm_postfork 로 푼다. pthread_atfork(mm_prefork, mm_postfork, mm_postfork) 로 등록한다.
+ */
+void mm_prefork(void)
+{
+    int i;
+
+    pthread_mutex_lock(&arenas_lock);
+    for (i = 0; i < num_arenas; i++)
+        pthread_mutex_lock(&arenas[i].lock);
+    mem_prefork();
+}
+
+void mm_postfork(void)
+{
+    int i;
+
+    mem_postfork();
+    for (i = num_arenas - 1; i >= 0; i--)
+        pthread_mutex_unlock(&arenas[i].lock);
+    pthread_mutex_unlock(&arenas_lock);
+}
+
+/*
+ * 독립 힙(mm_heap_t) - 아레나 하나로 된 힙. 자기 영역(mem_region) 맨 앞에 힙
+ * 구조체를 두고 그 뒤를 힙으로 쓰므로, 영역 하나만 버리면 힙 전체가 블록 수와
+ * 상관없이 O(1) 에 사라진다. 기본 힙(mm_malloc 의 아레나들)이나 스레드 캐시와는
+ * 섞이지 않고, 힙마다 락이 있어서 여러 스레드가 같은 힙을 써도 된다.
+ */
+struct mm_heap {
+    arena_t arena;
+};
+
+#define HEAP_HDR_SIZE ALIGN(sizeof(mm_heap_t))  //  영역 맨 앞의 힙 구조체 크기
+
+/*
+ * mm_heap_create - size 바이트까지 자랄 수 있는 빈 힙을 만든다.
+ *     메모리가 없으면 NULL.
+ */
+mm_heap_t *mm_heap_create(size_t size)
+{
+    mem_region_t *region;
+    unsigned char *run_map;
+    mm_heap_t *h;
+
+    if ((region = mem_region_create(HEAP_HDR_SIZE + size)) == NULL)
+        return NULL;
+    if ((run_map = mem_reserve(RUN_MAP_SIZE(HEAP_HDR_SIZE + size))) == NULL) {
+        mem_region_destroy(region);
+        return NULL;
+    }
+
+    h = mem_region_sbrk(region, HEAP_HDR_SIZE);
+    memset(h, 0, sizeof(mm_heap_t));
+    pthread_mutex_init(&h->arena.lock, NULL);
+    h->arena.region = region;
+    h->arena.limit = HEAP_HDR_SIZE + size;
+    h->arena.run_map = run_map;
+    if (heap_init(&h->arena) == -1) {  //  첫 청크도 못 넣을 만큼 작은 힙
+        mem_unreserve(run_map, RUN_MAP_SIZE(HEAP_HDR_SIZE + size));
+        mem_region_destroy(region);
+        return NULL;
+    }
+    return h;
+}
+
+void *mm_heap_malloc(mm_heap_t *h, size_t size)
+{
+    void *bp;
+
+    pthread_mutex_lock(&h->arena.lock);
+    bp = heap_malloc(&h->arena, size);
+    pthread_mutex_unlock(&h->arena.lock);
+    return bp;
+}
+
+void mm_heap_free(mm_heap_t *h, void *ptr)
+{
+    if (ptr == NULL)
+        return;
+
+    pthread_mutex_lock(&h->arena.lock);
+    heap_free(&h->arena, ptr);
+    pthread_mutex_unlock(&h->arena.lock);
+}
+
+/*
+ * mm_heap_destroy - 힙 h 의 모든 블록을 영역째로 한 번에 돌려준다.
+ *     h 에서 받은 포인터는 모두 무효가 된다.
+ */
+void mm_heap_destroy(mm_heap_t *h)
+{
+    mem_region_t *region = h->arena.region;  //  h 자신도 영역 안에 있으므로 먼저 꺼내 둔다
+
+    pthread_mutex_destroy(&h->arena.lock);
+    mem_unreserve(h->arena.run_map, RUN_MAP_SIZE(h->arena.limit));
+    mem_region_destroy(region);
+}
+
+/*
+ * 오브젝트 풀(mm_pool_t) - 크기가 같은 오브젝트만 나눠 주는 할당기. 힙에서 청크를
+ * 받아 앞에서부터 잘라 주고, free 된 오브젝트는 첫 워드로 엮은 스택에 넣었다가
+ * 먼저 다시 준다. 오브젝트마다 header 가 없고, 크기 클래스 계산도 가용 블록 탐색도
+ * 경계 태그 쓰기도 없다. 락이 없으므로 풀 하나는 한 번에 한 스레드만 쓴다.
+ */
+#define POOL_CHUNK (16 * CHUNKSIZE)       //  풀이 힙에서 한 번에 받는 청크 크기
+#define POOL_MIN_OBJS 8                   //  큰 오브젝트도 청크 하나에 이만큼은 들어가게 한다
+#define POOL_NEXT(obj) (*(void **)(obj))  //  free 오브젝트(와 청크)의 첫 워드에 다음 것을 저장
+
+struct mm_pool {
+    size_t obj_size;    //  오브젝트 간격 (align 의 배수로 올린 크기)
+    size_t align;       //  오브젝트 주소 정렬
+    size_t chunk_size;  //  청크 하나의 크기
+    void *free_list;    //  free 된 오브젝트 스택
+    char *bump;         //  마지막 청크에서 아직 나눠 준 적 없는 부분 [bump, end)
+    char *end;
+    void *chunks;       //  받은 청크 리스트 (mm_pool_destroy 가 돌려준다)
+};
+
+/*
+ * mm_pool_create - obj_size 바이트 오브젝트를 align(2의 거듭제곱, 0 이면 ALIGNMENT) 의
+ *     배수 주소로 나눠 주는 빈 풀을 만든다. 잘못된 인자거나 메모리가 없으면 NULL.
+ */
+mm_pool_t *mm_pool_create(size_t obj_size, size_t align)
+{
+    mm_pool_t *p;
+
+    if (align == 0)
+        align = ALIGNMENT;
+    if ((align & (align - 1)) != 0 || align > POOL_CHUNK || obj_size == 0 ||
+        obj_size > INT_MAX / (2 * POOL_MIN_OBJS))
+        return NULL;
+    align = MAX(align, PTRSIZE);  //  free 오브젝트에 포인터를 쓸 수 있어야 한다
+    if ((p = mm_malloc(sizeof(mm_pool_t))) == NULL)
+        return NULL;
+
+    p->align = align;
+    p->obj_size = (MAX(obj_size, PTRSIZE) + align - 1) & ~(align - 1);
+    p->chunk_size = MAX(POOL_CHUNK, align + POOL_MIN_OBJS * p->obj_size);
+    p->free_list = NULL;
+    p->bump = p->end = NULL;
+    p->chunks = NULL;
+    return p;
+}
+
+//  청크를 하나 더 받아 bump 영역으로 삼는다. 청크 맨 앞 align 바이트에 청크 리스트 포인터를 둔다
+static int pool_grow(mm_pool_t *p)
+{
+    char *chunk;
+
+    if ((chunk = mm_memalign(p->align, p->chunk_size)) == NULL)
+        return -1;
+    POOL_NEXT(chunk) = p->chunks;
+    p->chunks = chunk;
+    p->bump = chunk + p->align;
+    p->end = chunk + p->chunk_size;
+    return 0;
+}
+
+// free 된 오브젝트가 있으면 그것을, 없으면 마지막 청크에서 하나 잘라 준다
+void *mm_pool_alloc(mm_pool_t *p)
+{
+    void *obj;
+
+    if ((obj = p->free_list) != NULL) {
+        p->free_list = POOL_NEXT(obj);
+        return obj;
+    }
+    if ((size_t)(p->end - p->bump) < p->obj_size && pool_grow(p) == -1)
+        return NULL;
+    obj = p->bump;
+    p->bump += p->obj_size;
+    return obj;
+}
+
+void mm_pool_free(mm_pool_t *p, void *obj)
+{
+    if (obj == NULL)
+        return;
+    POOL_NEXT(obj) = p->free_list;
+    p->free_list = obj;
+}
+
+/*
+ * mm_pool_destroy - 풀 p 의 청크를 모두 힙에 돌려준다.
+ *     p 에서 받은 오브젝트는 free 하지 않았어도 모두 무효가 된다.
+ */
+void mm_pool_destroy(mm_pool_t *p)
+{
+    void *chunk, *next;
+
+    for (chunk = p->chunks; chunk != NULL; chunk = next) {
+        next = POOL_NEXT(chunk);
+        mm_free(chunk);
+    }
+    mm_free(p);
+}
+
+/*
+ * 영역(mm_region_t) - 한꺼번에 버릴 오브젝트들을 위한 bump 포인터 할당기.
+ * 힙에서 받은 청크를 앞에서부터 잘라 주기만 하고 오브젝트별 free 는 없다.
+ * mm_region_reset 이 첫 청크만 남기고 모든 청크를 한 번에 돌려주고,
+ * mm_region_destroy 는 첫 청크까지 돌려준다. 영역 구조체는 첫 청크 맨 앞에 둔다.
+ * (memlib 의 mem_region 은 힙 아래의 brk 영역이고, 이것은 힙 위에서 청크로 만든다.)
+ * 풀처럼 락이 없으므로 한 번에 한 스레드만 쓴다.
+ */
+#define REGION_CHUNK (4 * CHUNKSIZE)             //  영역이 힙에서 한 번에 받는 청크 크기
+#define REGION_BIG (REGION_CHUNK / 4)            //  이보다 큰 요청은 자기만의 청크를 받는다
+#define REGION_CHUNK_HDR ALIGN(sizeof(void *))   //  청크 맨 앞의 다음 청크 포인터 자리
+#define REGION_NEXT(chunk) (*(void **)(chunk))
+
+struct mm_region {
+    void *chunks;  //  첫 청크 다음에 받은 청크 리스트 (청크 첫 워드로 연결)
+    char *bump;    //  지금 청크에서 남은 부분 [bump, end)
+    char *end;
+};
+
+#define REGION_HDR_SIZE ALIGN(sizeof(mm_region_t))  //  첫 청크 맨 앞의 영역 구조체 크기
+
+// 첫 청크 하나를 받아 그 앞에 영역 구조체를 둔다. 메모리가 없으면 NULL
+mm_region_t *mm_region_create(void)
+{
+    mm_region_t *r;
+
+    if ((r = mm_malloc(REGION_CHUNK)) == NULL)
+        return NULL;
+    r->chunks = NULL;
+    r->bump = (char *)r + REGION_HDR_SIZE;
+    r->end = (char *)r + REGION_CHUNK;
+    return r;
+}
+
+//  size 바이트가 들어가는 청크를 받아 리스트에 넣고, 청크 header 뒤의 주소를 돌려준다
+static char *region_chunk(mm_region_t *r, size_t size)
+{
+    char *chunk;
+
+    if ((chunk = mm_malloc(REGION_CHUNK_HDR + size)) == NULL)
+        return NULL;
+    REGION_NEXT(chunk) = r->chunks;
+    r->chunks = chunk;
+    return chunk + REGION_CHUNK_HDR;
+}
+
+// 지금 청크에서 size 바이트를 떼어 준다. 모자라면 새 청크로 넘어간다
+void *mm_region_alloc(mm_region_t *r, size_t size)
+{
+    char *p;
+
+    if (size == 0 || size > INT_MAX)
+        return NULL;
+    size = ALIGN(size);
+    if ((size_t)(r->end - r->bump) < size) {
+        //  큰 요청은 따로 받아서 지금 청크의 남은 부분을 버리지 않는다
+        if (size > REGION_BIG)
+            return region_chunk(r, size);
+        if ((p = region_chunk(r, REGION_CHUNK - REGION_CHUNK_HDR)) == NULL)
+            return NULL;
+        r->bump = p;
+        r->end = p + REGION_CHUNK - REGION_CHUNK_HDR;
+    }
+    p = r->bump;
+    r->bump += size;
+    return p;
+}
+
+/*
+ * mm_region_reset - 영역 r 에서 받은 메모리를 모두 버린다. 오브젝트 수와 상관없이
+ *     청크 수만큼만 free 하고, 첫 청크는 남겨서 다음에 다시 쓴다.
+ */
+void mm_region_reset(mm_region_t *r)
+{
+    void *chunk, *next;
+
+    for (chunk = r->chunks; chunk != NULL; chunk = next) {
+        next = REGION_NEXT(chunk);
+        mm_free(chunk);
+    }
+    r->chunks = NULL;
+    r->bump = (char *)r + REGION_HDR_SIZE;
+    r->end = (char *)r + REGION_CHUNK;
+}
+
+void mm_region_destroy(mm_region_t *r)
+{
+    mm_region_reset(r);
+    mm_free(r);
+}
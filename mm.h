@@ -2,8 +2,71 @@
 
 extern int mm_init (void);
 extern void *mm_malloc (size_t size);
+extern void *mm_calloc(size_t nmemb, size_t size);
 extern void mm_free (void *ptr);
 extern void *mm_realloc(void *ptr, size_t size);
+extern void mm_set_mmap_threshold(size_t size);
+extern void mm_free_sized(void *ptr, size_t size);
+extern size_t mm_malloc_batch(size_t size, size_t n, void **out);
+extern void mm_free_batch(void **ptrs, size_t n);
+extern void *mm_memalign(size_t alignment, size_t size);
+extern void *mm_aligned_alloc(size_t alignment, size_t size);
+extern size_t mm_usable_size(void *ptr);
+
+/* Placement policies of the heap's free-block search, chosen with
+   mm_set_policy or else the MM_POLICY environment variable ("first",
+   "next", "best" or "good") read by the first mm_init */
+typedef enum {
+    MM_FIRST_FIT,  /* the first block that fits (the default) */
+    MM_NEXT_FIT,   /* first fit, starting where the last search stopped */
+    MM_BEST_FIT,   /* the smallest block that fits */
+    MM_GOOD_FIT,   /* the smallest of the first few blocks that fit */
+    MM_NUM_POLICIES
+} mm_policy_t;
+
+extern int mm_set_policy(mm_policy_t policy);
+extern const char *mm_policy_name(int policy);  /* its MM_POLICY name, NULL if unknown */
+
+/* Deferred coalescing: counters of the quick lists of all arenas and of
+   the thread caches (heap blocks only) since mm_init */
+typedef struct {
+    size_t frees;          /* frees left uncoalesced on a quick list or in a thread cache */
+    size_t hits;           /* mallocs served from either: coalesce/split pairs avoided */
+    size_t consolidations; /* times the quick lists were coalesced in one batch */
+    size_t consolidated;   /* blocks coalesced by those batches */
+} mm_quick_stats_t;
+
+extern void mm_quick_stats(mm_quick_stats_t *st);
+
+/* Fork safety: register with pthread_atfork(mm_prefork, mm_postfork, mm_postfork) */
+extern void mm_prefork(void);
+extern void mm_postfork(void);
+
+/* Independent heaps, each released all at once by mm_heap_destroy */
+typedef struct mm_heap mm_heap_t;
+
+extern mm_heap_t *mm_heap_create(size_t size);
+extern void *mm_heap_malloc(mm_heap_t *h, size_t size);
+extern void mm_heap_free(mm_heap_t *h, void *ptr);
+extern void mm_heap_destroy(mm_heap_t *h);
+
+/* Pools of same-size objects without headers. A pool has no lock, so
+   only one thread at a time may use it */
+typedef struct mm_pool mm_pool_t;
+
+extern mm_pool_t *mm_pool_create(size_t obj_size, size_t align);
+extern void *mm_pool_alloc(mm_pool_t *p);
+extern void mm_pool_free(mm_pool_t *p, void *obj);
+extern void mm_pool_destroy(mm_pool_t *p);
+
+/* Regions: bump allocation, and everything freed at once by
+   mm_region_reset or mm_region_destroy. No lock either */
+typedef struct mm_region mm_region_t;
+
+extern mm_region_t *mm_region_create(void);
+extern void *mm_region_alloc(mm_region_t *r, size_t size);
+extern void mm_region_reset(mm_region_t *r);
+extern void mm_region_destroy(mm_region_t *r);
 
 
 /* 
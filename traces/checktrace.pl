@@ -81,6 +81,30 @@ while ($line = <STDIN>) {
     # save the line for output later
     $lines[$requestnum++] = $line;
 
+    # a region scope marker has no id
+    if ($cmd eq "b" or $cmd eq "e") {
+	next;
+    }
+
+    # a batch request allocates or frees each of its ids
+    if ($cmd eq "A" or $cmd eq "F") {
+	for ($i = $id; $i < $id + $size; $i++) {
+	    if ($cmd eq "A" and exists($HASH{$i})) {
+		die "$0: ERROR[$linenum]: allocate with no intervening free.\n";
+	    }
+	    if ($cmd eq "F" and !exists($HASH{$i})) {
+		die "$0: ERROR[$linenum]: freeing unallocated block.\n";
+	    }
+	    if ($cmd eq "A") {
+		$HASH{$i} = "a";
+	    }
+	    else {
+		delete $HASH{$i};
+	    }
+	}
+	next;
+    }
+
     #ignore realloc requests, as long as they are preceeded by an alloc request
     if ($cmd eq "r") {
 	if (!$HASH{$id}) {
@@ -89,6 +113,11 @@ while ($line = <STDIN>) {
 	next;
     }
 
+    # an aligned or zeroed allocate request counts as an allocate request
+    if ($cmd eq "m" or $cmd eq "c") {
+	$cmd = "a";
+    }
+
     if ($cmd eq "a" and $HASH{$id} eq "a") {
 	die "$0: ERROR[$linenum]: allocate with no intervening free.\n";
     }
@@ -0,0 +1,71 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+
+#
+# gen_align.pl - random mix of plain and aligned allocate requests:
+# cache-line (64-byte) aligned ring slots and page (4096-byte) aligned
+# I/O buffers among ordinary mallocs, freed in random order.
+#
+$out_filename = $ARGV[0];
+$out_filename = "align.rep" unless $out_filename;
+$num_blocks = $ARGV[1];
+$num_blocks = 2400 unless $num_blocks;
+
+# Create trace
+# Make a series of malloc()s and memalign()s
+for ($i = 0;  $i < $num_blocks; $i += 1) {
+    $op = {};
+    $op->{seq} = $i;
+    $r = rand;
+    if ($r < 0.5) {
+	$op->{type} = "a";
+	$op->{size} = int(rand 1024) + 1;
+    } elsif ($r < 0.8) {
+	$op->{type} = "m";
+	$op->{align} = 64;
+	$op->{size} = 16 * (int(rand 32) + 1);
+    } else {
+	$op->{type} = "m";
+	$op->{align} = 4096;
+	$op->{size} = 512 * (int(rand 16) + 1);
+    }
+    $total_block_size += $op->{size};
+    push @trace, $op;
+}
+# Insert free()s in proper places
+for ($i = 0;  $i < $num_blocks; $i += 1) {
+    for ($minval = $i; $minval < $num_blocks + $i; $minval += 1) {
+        if (($trace[$minval]->{type} ne "f") && ($trace[$minval]->{seq} == $i)) {
+            last;
+        }
+    }
+    $pos = int(rand($num_blocks + $i - $minval - 1) + $minval + 1);
+    $op = {};
+    $op->{type} = "f";
+    $op->{seq} = $i;
+    splice @trace, $pos, 0, $op;
+}
+
+# Open output file
+open OUTFILE, ">$out_filename" or die "Cannot create $out_filename\n";
+
+# Calculate misc parameters
+$suggested_heap_size = $total_block_size + 100;
+$num_ops = 2*$num_blocks;
+
+print OUTFILE "$suggested_heap_size\n";
+print OUTFILE "$num_blocks\n";
+print OUTFILE "$num_ops\n";
+print OUTFILE "1\n";
+
+for ($i = 0;  $i < 2*$num_blocks; $i += 1) {
+    if ($trace[$i]->{type} eq "a") {
+        print OUTFILE "$trace[$i]->{type} $trace[$i]->{seq} $trace[$i]->{size}\n";
+    } elsif ($trace[$i]->{type} eq "m") {
+        print OUTFILE "$trace[$i]->{type} $trace[$i]->{seq} $trace[$i]->{align} $trace[$i]->{size}\n";
+    } else {
+        print OUTFILE "$trace[$i]->{type} $trace[$i]->{seq}\n";
+    }
+}
+
+close OUTFILE;
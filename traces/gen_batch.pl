@@ -0,0 +1,52 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+
+#
+# gen_batch.pl - batches of same-size blocks, as allocated by callers
+# that fill a pool or a ring at once. Each batch is allocated by one
+# batch request (A) and freed either by one batch request (F) or block
+# by block (f), at random times within the next $window batches.
+#
+$out_filename = $ARGV[0];
+$out_filename = "batch.rep" unless $out_filename;
+$num_batches = $ARGV[1];
+$num_batches = 400 unless $num_batches;
+$window = 50;
+
+@sizes = (16, 24, 32, 48, 64, 96, 128, 200, 256, 512);
+
+# Create trace, as a list of [time, request] pairs
+$id = 0;
+for ($b = 0;  $b < $num_batches; $b += 1) {
+    $n = 8 + int(rand 57);
+    $size = $sizes[int(rand @sizes)];
+    $total_block_size += $n * $size;
+    push @trace, [$b, "A $id $n $size"];
+    if (rand() < 0.6) {
+	push @trace, [$b + 0.5 + rand($window), "F $id $n"];
+    } else {
+	for ($j = 0;  $j < $n; $j += 1) {
+	    push @trace, [$b + 0.5 + rand($window), "f " . ($id + $j)];
+	}
+    }
+    $id += $n;
+}
+@trace = sort { $a->[0] <=> $b->[0] } @trace;
+
+# Open output file
+open OUTFILE, ">$out_filename" or die "Cannot create $out_filename\n";
+
+# Calculate misc parameters
+$suggested_heap_size = $total_block_size + 100;
+$num_ops = scalar @trace;
+
+print OUTFILE "$suggested_heap_size\n";
+print OUTFILE "$id\n";
+print OUTFILE "$num_ops\n";
+print OUTFILE "1\n";
+
+foreach $op (@trace) {
+    print OUTFILE "$op->[1]\n";
+}
+
+close OUTFILE;
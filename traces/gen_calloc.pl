@@ -0,0 +1,72 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+
+#
+# gen_calloc.pl - random mix of plain allocate requests and zeroed
+# allocate requests: large zeroed arrays of 4- or 8-byte elements (1 to
+# 64 KB) and small zeroed structs among ordinary mallocs, freed in
+# random order. Measures how much zeroing calloc can skip.
+#
+$out_filename = $ARGV[0];
+$out_filename = "calloc.rep" unless $out_filename;
+$num_blocks = $ARGV[1];
+$num_blocks = 1200 unless $num_blocks;
+
+# Create trace
+# Make a series of malloc()s and calloc()s
+for ($i = 0;  $i < $num_blocks; $i += 1) {
+    $op = {};
+    $op->{seq} = $i;
+    $r = rand;
+    if ($r < 0.4) {
+	$op->{type} = "a";
+	$op->{size} = int(rand 1024) + 1;
+    } elsif ($r < 0.6) {
+	$op->{type} = "c";
+	$op->{nmemb} = int(rand 16) + 1;
+	$op->{size} = 8 * (int(rand 4) + 1);
+    } else {
+	$op->{type} = "c";
+	$op->{size} = (rand() < 0.5) ? 4 : 8;
+	$op->{nmemb} = int(rand(65536 / $op->{size} - 256)) + 256;
+    }
+    $total_block_size += ($op->{type} eq "c") ? $op->{nmemb} * $op->{size} : $op->{size};
+    push @trace, $op;
+}
+# Insert free()s in proper places
+for ($i = 0;  $i < $num_blocks; $i += 1) {
+    for ($minval = $i; $minval < $num_blocks + $i; $minval += 1) {
+        if (($trace[$minval]->{type} ne "f") && ($trace[$minval]->{seq} == $i)) {
+            last;
+        }
+    }
+    $pos = int(rand($num_blocks + $i - $minval - 1) + $minval + 1);
+    $op = {};
+    $op->{type} = "f";
+    $op->{seq} = $i;
+    splice @trace, $pos, 0, $op;
+}
+
+# Open output file
+open OUTFILE, ">$out_filename" or die "Cannot create $out_filename\n";
+
+# Calculate misc parameters
+$suggested_heap_size = $total_block_size + 100;
+$num_ops = 2*$num_blocks;
+
+print OUTFILE "$suggested_heap_size\n";
+print OUTFILE "$num_blocks\n";
+print OUTFILE "$num_ops\n";
+print OUTFILE "1\n";
+
+for ($i = 0;  $i < 2*$num_blocks; $i += 1) {
+    if ($trace[$i]->{type} eq "a") {
+        print OUTFILE "$trace[$i]->{type} $trace[$i]->{seq} $trace[$i]->{size}\n";
+    } elsif ($trace[$i]->{type} eq "c") {
+        print OUTFILE "$trace[$i]->{type} $trace[$i]->{seq} $trace[$i]->{nmemb} $trace[$i]->{size}\n";
+    } else {
+        print OUTFILE "$trace[$i]->{type} $trace[$i]->{seq}\n";
+    }
+}
+
+close OUTFILE;
@@ -0,0 +1,76 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+
+#
+# gen_region.pl - phases of short-lived blocks between a few long-lived
+# ones, like the requests of a server or a compiler pass. Each phase is
+# a region scope [b ... e]: 64 to 256 blocks of 8 to 256 bytes, a few
+# of them grown by realloc, all freed in random order before the scope
+# ends. Between the phases a few long-lived blocks are allocated, and
+# some older ones freed. Compare mdriver with and without -R to see
+# what freeing a whole scope with mm_region_reset saves.
+#
+$out_filename = $ARGV[0];
+$out_filename = "region.rep" unless $out_filename;
+$num_phases = $ARGV[1];
+$num_phases = 60 unless $num_phases;
+
+$id = 0;
+@long = ();
+for ($p = 0;  $p < $num_phases; $p += 1) {
+    # Long-lived blocks outside of the scopes
+    for ($i = int(rand 4) + 1;  $i > 0; $i -= 1) {
+	$size = int(rand 2048) + 64;
+	push @trace, "a $id $size";
+	push @long, $id++;
+	$total_block_size += $size;
+    }
+    if (@long > 16) {
+	$i = int(rand @long);
+	push @trace, "f $long[$i]";
+	splice @long, $i, 1;
+    }
+
+    # A scope of short-lived blocks
+    push @trace, "b";
+    @short = ();
+    for ($i = int(rand 193) + 64;  $i > 0; $i -= 1) {
+	$size = int(rand 249) + 8;
+	push @trace, "a $id $size";
+	push @short, $id++;
+	$total_block_size += $size;
+	if (rand() < 0.05) {
+	    $size += int(rand 512) + 1;
+	    push @trace, "r $short[int(rand @short)] $size";
+	}
+	if (rand() < 0.2) {
+	    $j = int(rand @short);
+	    push @trace, "f $short[$j]";
+	    splice @short, $j, 1;
+	}
+    }
+    while (@short) {
+	$j = int(rand @short);
+	push @trace, "f $short[$j]";
+	splice @short, $j, 1;
+    }
+    push @trace, "e";
+}
+
+# Open output file
+open OUTFILE, ">$out_filename" or die "Cannot create $out_filename\n";
+
+# Calculate misc parameters
+$suggested_heap_size = $total_block_size + 100;
+$num_ops = @trace;
+
+print OUTFILE "$suggested_heap_size\n";
+print OUTFILE "$id\n";
+print OUTFILE "$num_ops\n";
+print OUTFILE "1\n";
+
+foreach $line (@trace) {
+    print OUTFILE "$line\n";
+}
+
+close OUTFILE;